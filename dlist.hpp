@@ -0,0 +1,420 @@
+// Type-safe C++ double linked list on top of the List pool.
+// Header only, the List library is linked in as it is.
+//
+// A dlist<T> is an inline list (see List_create_inline) whose elements are constructed in
+// place inside the nodes, so adding an element never allocates from the heap. T must fit
+// in LIST_INLINE_MAX_SIZE bytes and must not need more alignment than a pointer; define
+// LIST_INLINE_MAX_SIZE when compiling for bigger elements. Move-only types are fine, the
+// list never copies or moves its elements once they are in it.
+//
+//     dlist<std::unique_ptr<Job>> jobs;
+//     jobs.emplace_back(new Job);
+//     auto it = std::find_if(jobs.begin(), jobs.end(), [](auto &pJob) { return pJob->isDue(); });
+//
+// Iterators are bidirectional and work with <algorithm>. An iterator stays valid while its
+// element is in the list. remove_if and sort take predicates and comparators as templates,
+// so they are inlined into the callbacks the C functions call instead of going through
+// COMPARATOR_FN and ORDER_FN pointers of their own, and so is ~T() when elements are erased.
+// They must not throw, as they are called from C. Functions that need a node throw
+// std::bad_alloc when the pool is empty.
+//
+// dlist_pool_resource is a std::pmr::memory_resource handing out node sized blocks from the
+// same pool, for std::pmr containers of small objects.
+
+#ifndef _DLIST_HPP_
+#define _DLIST_HPP_
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "list.h"
+
+template <class T>
+class dlist {
+    static_assert(sizeof(T) <= LIST_INLINE_MAX_SIZE, "T must fit in a node, see LIST_INLINE_MAX_SIZE");
+    static_assert(alignof(T) <= alignof(void*), "T must not need more alignment than a pointer");
+
+public:
+    using value_type = T;
+    using reference = T&;
+    using const_reference = const T&;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    template <bool isConst>
+    class basic_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<isConst, const T*, T*>;
+        using reference = std::conditional_t<isConst, const T&, T&>;
+
+        basic_iterator() = default;
+
+        // An iterator converts to a const_iterator.
+        template <bool wasConst, class = std::enable_if_t<isConst && !wasConst>>
+        basic_iterator(const basic_iterator<wasConst>& other) : pList(other.pList), ref(other.ref) {}
+
+        reference operator*() const { return *operator->(); }
+        pointer operator->() const { return static_cast<pointer>(List_ref_item(pList, ref)); }
+
+        basic_iterator& operator++()
+        {
+            ref = List_next_ref(pList, ref);
+            return *this;
+        }
+        basic_iterator operator++(int)
+        {
+            basic_iterator old = *this;
+            ++*this;
+            return old;
+        }
+        //end() steps back to the last element
+        basic_iterator& operator--()
+        {
+            ref = ref ? List_prev_ref(pList, ref) : List_last_ref(pList);
+            return *this;
+        }
+        basic_iterator operator--(int)
+        {
+            basic_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) { return a.ref == b.ref; }
+        friend bool operator!=(const basic_iterator& a, const basic_iterator& b) { return a.ref != b.ref; }
+
+    private:
+        friend class dlist;
+        template <bool>
+        friend class basic_iterator;
+
+        basic_iterator(List* pList, NodeRef ref) : pList(pList), ref(ref) {}
+
+        List* pList = nullptr;
+        //node of the element, 0 for end()
+        NodeRef ref = 0;
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    // Takes a head out of the pool, throws std::bad_alloc if there is none left.
+    dlist() : pList(s_create()) {}
+
+    // Takes over the head of other, which is left without one and may only be
+    // destroyed or assigned to.
+    dlist(dlist&& other) noexcept : pList(std::exchange(other.pList, nullptr)) {}
+
+    dlist& operator=(dlist&& other) noexcept
+    {
+        if (this != &other)
+        {
+            s_release(pList);
+            pList = std::exchange(other.pList, nullptr);
+        }
+        return *this;
+    }
+
+    dlist(const dlist&) = delete;
+    dlist& operator=(const dlist&) = delete;
+
+    // Destroys the elements and gives the nodes and the head back to the pool.
+    ~dlist() { s_release(pList); }
+
+    // The List underneath, for the List_* functions that have no counterpart here.
+    List* list() const { return pList; }
+
+    size_type size() const { return List_count(pList); }
+    bool empty() const { return List_count(pList) == 0; }
+
+    iterator begin() { return iterator(pList, List_first_ref(pList)); }
+    iterator end() { return iterator(pList, 0); }
+    const_iterator begin() const { return const_iterator(pList, List_first_ref(pList)); }
+    const_iterator end() const { return const_iterator(pList, 0); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    T& front() { return *begin(); }
+    T& back() { return *--end(); }
+    const T& front() const { return *begin(); }
+    const T& back() const { return *--end(); }
+
+    // Constructs an element from args in a new node at the back or the front.
+    template <class... Args>
+    T& emplace_back(Args&&... args)
+    {
+        s_check(List_push_back(pList, s_blank));
+        return s_construct(List_last_ref(pList), std::forward<Args>(args)...);
+    }
+    template <class... Args>
+    T& emplace_front(Args&&... args)
+    {
+        s_check(List_push_front(pList, s_blank));
+        return s_construct(List_first_ref(pList), std::forward<Args>(args)...);
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+    void push_front(const T& value) { emplace_front(value); }
+    void push_front(T&& value) { emplace_front(std::move(value)); }
+
+    // Constructs an element from args in a new node before pos.
+    template <class... Args>
+    iterator emplace(const_iterator pos, Args&&... args)
+    {
+        List_seek_ref(pList, pos.ref);
+        s_check(List_insert(pList, s_blank));
+        NodeRef ref = List_item_ref(pList, List_curr(pList));
+        s_construct(ref, std::forward<Args>(args)...);
+        return iterator(pList, ref);
+    }
+
+    iterator insert(const_iterator pos, const T& value) { return emplace(pos, value); }
+    iterator insert(const_iterator pos, T&& value) { return emplace(pos, std::move(value)); }
+
+    // Destroys the element at pos and returns the iterator after it.
+    iterator erase(const_iterator pos)
+    {
+        NodeRef next = List_next_ref(pList, pos.ref);
+        pos->~T();
+        List_seek_ref(pList, pos.ref);
+        List_remove(pList);
+        return iterator(pList, next);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        while (first != last)
+        {
+            first = erase(first);
+        }
+        return iterator(pList, last.ref);
+    }
+
+    void pop_back()
+    {
+        back().~T();
+        List_pop_back(pList);
+    }
+
+    void pop_front()
+    {
+        front().~T();
+        List_pop_front(pList);
+    }
+
+    // Destroys all elements, in one pass like List_remove_if.
+    void clear() { List_remove_if(pList, s_destroy<AnyItem>, nullptr, nullptr); }
+
+    // Destroys every element pred returns true for, in one pass. Returns how many there were.
+    template <class Pred>
+    size_type remove_if(Pred pred)
+    {
+        return List_remove_if(pList, s_destroy<Pred>, &pred, nullptr);
+    }
+
+    size_type remove(const T& value)
+    {
+        return remove_if([&value](const T& item) { return item == value; });
+    }
+
+    // Sorts the elements by comp, stable like List_sort. Nodes are relinked,
+    // elements stay where they are.
+    template <class Compare = std::less<>>
+    void sort(Compare comp = Compare())
+    {
+        Compare* pOld = std::exchange(s_pCompare<Compare>, &comp);
+        List_sort(pList, s_order<Compare>);
+        s_pCompare<Compare> = pOld;
+    }
+
+    // Merges other, sorted by comp like this list is, into this list; other is left empty.
+    // This and splice_back need no free head, other takes back the head it gave up.
+    template <class Compare = std::less<>>
+    void merge(dlist& other, Compare comp = Compare())
+    {
+        Compare* pOld = std::exchange(s_pCompare<Compare>, &comp);
+        List_merge(pList, std::exchange(other.pList, nullptr), s_order<Compare>);
+        s_pCompare<Compare> = pOld;
+        //List_merge freed the head of other, which gets a new one, the same head in a full pool
+        other.pList = s_create();
+    }
+
+    // Moves all elements of other to the end of this list in O(1); other is left empty.
+    void splice_back(dlist& other)
+    {
+        List_concat(pList, std::exchange(other.pList, nullptr));
+        other.pList = s_create();
+    }
+
+private:
+    //bytes copied into a new node before its element is constructed over them
+    alignas(void*) static inline unsigned char s_blank[sizeof(T)] = {};
+    //comparator of the sort or merge running on this thread, for the ORDER_FN callback
+    template <class Compare>
+    static inline thread_local Compare* s_pCompare = nullptr;
+
+    //predicate of clear
+    struct AnyItem {
+        bool operator()(const T&) const { return true; }
+    };
+
+    static List* s_create()
+    {
+        List* pList = List_create_inline(sizeof(T));
+        if (!pList)
+        {
+            throw std::bad_alloc();
+        }
+        return pList;
+    }
+
+    static void s_release(List* pList)
+    {
+        if (pList)
+        {
+            List_remove_if(pList, s_destroy<AnyItem>, nullptr, nullptr);
+            List_free(pList, s_free_nothing);
+        }
+    }
+
+    static void s_free_nothing(void*) {}
+
+    static void s_check(int result)
+    {
+        if (result != 0)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    //construct the element of a node just added, taking the node out again if that throws
+    template <class... Args>
+    T& s_construct(NodeRef ref, Args&&... args)
+    {
+        void* pItem = List_ref_item(pList, ref);
+        try
+        {
+            return *::new (pItem) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            List_seek_ref(pList, ref);
+            List_remove(pList);
+            throw;
+        }
+    }
+
+    //COMPARATOR_FN for List_remove_if, destroying the elements it lets go
+    template <class Pred>
+    static bool s_destroy(void* pItem, void* pArg)
+    {
+        T& item = *static_cast<T*>(pItem);
+        bool isMatch;
+        if constexpr (std::is_same_v<Pred, AnyItem>)
+        {
+            isMatch = true;
+        }
+        else
+        {
+            isMatch = (*static_cast<Pred*>(pArg))(std::as_const(item));
+        }
+        if (isMatch)
+        {
+            item.~T();
+        }
+        return isMatch;
+    }
+
+    //ORDER_FN for List_sort and List_merge
+    template <class Compare>
+    static int s_order(void* pItem1, void* pItem2)
+    {
+        Compare& comp = *s_pCompare<Compare>;
+        const T& item1 = *static_cast<T*>(pItem1);
+        const T& item2 = *static_cast<T*>(pItem2);
+        if (comp(item1, item2))
+        {
+            return -1;
+        }
+        return comp(item2, item1) ? 1 : 0;
+    }
+
+    List* pList;
+};
+
+// A std::pmr::memory_resource that hands out blocks of up to LIST_INLINE_MAX_SIZE bytes,
+// aligned to at most a pointer, from the node pool, and passes bigger blocks on to its
+// upstream resource. Each block is a node of an inline list the resource owns, so a block
+// is taken and given back in O(1). Throws std::bad_alloc when the pool is empty.
+class dlist_pool_resource : public std::pmr::memory_resource {
+public:
+    explicit dlist_pool_resource(std::pmr::memory_resource* pUpstream = std::pmr::get_default_resource())
+        : pList(List_create_inline(LIST_INLINE_MAX_SIZE)), pUpstream(pUpstream)
+    {
+        if (!pList)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    dlist_pool_resource(const dlist_pool_resource&) = delete;
+    dlist_pool_resource& operator=(const dlist_pool_resource&) = delete;
+
+    // Gives back the nodes of any blocks still handed out, along with the head.
+    ~dlist_pool_resource() override { List_free(pList, s_free_nothing); }
+
+    std::pmr::memory_resource* upstream_resource() const { return pUpstream; }
+
+private:
+    static bool s_fits(std::size_t bytes, std::size_t alignment)
+    {
+        return bytes <= LIST_INLINE_MAX_SIZE && alignment <= alignof(void*);
+    }
+
+    static void s_free_nothing(void*) {}
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (!s_fits(bytes, alignment))
+        {
+            return pUpstream->allocate(bytes, alignment);
+        }
+        alignas(void*) static unsigned char blank[LIST_INLINE_MAX_SIZE] = {};
+        if (List_push_back(pList, blank) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        return List_ref_item(pList, List_last_ref(pList));
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        if (!s_fits(bytes, alignment))
+        {
+            pUpstream->deallocate(p, bytes, alignment);
+            return;
+        }
+        List_seek_ref(pList, List_item_ref(pList, p));
+        List_remove(pList);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    List* pList;
+    std::pmr::memory_resource* pUpstream;
+};
+
+#endif
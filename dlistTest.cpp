@@ -0,0 +1,238 @@
+/**
+ * Test routine for the dlist<T> C++ wrapper.
+ */
+
+#include "dlist.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+// Macro for custom testing; does exit(1) on failure.
+#define CHECK(condition) do{ \
+    if (!(condition)) { \
+        printf("ERROR: %s (@%d): failed condition \"%s\"\n", __func__, __LINE__, #condition); \
+        exit(1);\
+    }\
+} while(0)
+
+//counts live instances, to check every element is destroyed exactly once
+static int s_numLive = 0;
+
+struct Counted {
+    int value;
+    explicit Counted(int value) : value(value) { ++s_numLive; }
+    Counted(Counted&& other) : value(other.value) { ++s_numLive; }
+    Counted(const Counted&) = delete;
+    ~Counted() { --s_numLive; }
+};
+
+//throws from its constructor when asked to
+struct Throwing {
+    int value;
+    explicit Throwing(int value) : value(value) {
+        if(value < 0){
+            throw value;
+        }
+    }
+};
+
+static void s_test_elements(){
+    {
+        dlist<int> list;
+        CHECK(list.empty());
+        list.push_back(2);
+        list.push_back(3);
+        list.push_front(1);
+        list.emplace(std::next(list.begin()), 9);
+        CHECK(list.size() == 4);
+        CHECK(list.front() == 1 && list.back() == 3);
+
+        //iterators work with <algorithm>, both ways
+        std::vector<int> values(list.begin(), list.end());
+        CHECK((values == std::vector<int>{1, 9, 2, 3}));
+        std::vector<int> reversed(list.rbegin(), list.rend());
+        CHECK((reversed == std::vector<int>{3, 2, 9, 1}));
+        CHECK(std::accumulate(list.cbegin(), list.cend(), 0) == 15);
+        auto it = std::find_if(list.begin(), list.end(), [](int value) { return value > 5; });
+        CHECK(it != list.end() && *it == 9);
+        CHECK(std::count_if(list.begin(), list.end(), [](int value) { return value % 2; }) == 3);
+        std::reverse(list.begin(), list.end());
+        CHECK(list.front() == 3 && list.back() == 1);
+
+        //erase hands back the iterator after the element
+        it = list.erase(std::find(list.begin(), list.end(), 9));
+        CHECK(*it == 1);
+        list.insert(list.end(), 7);
+        list.sort();
+        CHECK(std::is_sorted(list.begin(), list.end()));
+        list.sort(std::greater<int>());
+        CHECK(list.front() == 7 && list.back() == 1);
+        CHECK(list.remove(2) == 1);
+        CHECK(list.size() == 3);
+        list.pop_front();
+        list.pop_back();
+        CHECK(list.size() == 1 && list.front() == 3);
+    }
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+
+static void s_test_move_only(){
+    {
+        //move-only elements are constructed in place and destroyed on the way out
+        dlist<std::unique_ptr<Counted>> list;
+        for(int i = 0; i < 6; ++i){
+            list.emplace_back(new Counted(i));
+        }
+        list.push_front(std::make_unique<Counted>(-1));
+        CHECK(s_numLive == 7);
+
+        CHECK(list.remove_if([](const std::unique_ptr<Counted> &pItem) { return pItem->value % 2 == 0; }) == 3);
+        CHECK(s_numLive == 4);
+        CHECK(list.front()->value == -1);
+        list.erase(list.begin());
+        CHECK(s_numLive == 3);
+
+        //sort relinks nodes, elements stay where they are
+        Counted *pFirst = list.front().get();
+        list.sort([](const std::unique_ptr<Counted> &a, const std::unique_ptr<Counted> &b) { return a->value > b->value; });
+        CHECK(list.front()->value == 5 && list.back().get() == pFirst);
+
+        //moving the list moves the head, not the elements
+        dlist<std::unique_ptr<Counted>> other(std::move(list));
+        CHECK(other.size() == 3 && s_numLive == 3);
+        other.clear();
+        CHECK(other.empty() && s_numLive == 0);
+
+        dlist<Counted> counted;
+        counted.emplace_back(1);
+        counted.emplace_front(0);
+        CHECK(s_numLive == 2);
+    }
+    CHECK(s_numLive == 0);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+
+static void s_test_merge(){
+    {
+        dlist<int> odd;
+        dlist<int> even;
+        for(int i = 0; i < 5; ++i){
+            odd.push_back(i * 2 + 1);
+            even.push_back(i * 2);
+        }
+        odd.merge(even);
+        CHECK(odd.size() == 10 && even.empty());
+        int expected = 0;
+        for(int value : odd){
+            CHECK(value == expected++);
+        }
+
+        //the emptied list is still usable
+        even.push_back(10);
+        odd.splice_back(even);
+        CHECK(odd.size() == 11 && odd.back() == 10 && even.empty());
+    }
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+
+    {
+        //with every head taken, the head other gives up is the one it gets back
+        std::vector<dlist<int>> lists;
+        lists.reserve(LIST_MAX_NUM_HEADS);
+        try{
+            for(;;){
+                lists.emplace_back();
+            }
+        }catch(std::bad_alloc &){
+        }
+        CHECK(lists.size() >= 3);
+        lists[0].push_back(1);
+        lists[1].push_back(0);
+        lists[2].push_back(2);
+        lists[0].merge(lists[1]);
+        lists[0].splice_back(lists[2]);
+        CHECK(lists[0].size() == 3 && lists[1].empty() && lists[2].empty());
+        int expected = 0;
+        for(int value : lists[0]){
+            CHECK(value == expected++);
+        }
+        lists[1].push_back(3);
+        CHECK(lists[1].front() == 3);
+    }
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+
+static void s_test_failures(){
+    {
+        //a throwing constructor leaves no node behind
+        dlist<Throwing> list;
+        list.emplace_back(1);
+        bool isThrown = false;
+        try{
+            list.emplace(list.begin(), -1);
+        }catch(int){
+            isThrown = true;
+        }
+        CHECK(isThrown && list.size() == 1);
+
+        //an empty pool throws bad_alloc
+        dlist<int> full;
+        isThrown = false;
+        try{
+            for(;;){
+                full.push_back(0);
+            }
+        }catch(std::bad_alloc &){
+            isThrown = true;
+        }
+        CHECK(isThrown && full.size() == LIST_MAX_NUM_NODES - 1);
+    }
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+
+static void s_test_resource(){
+    {
+        dlist_pool_resource resource;
+        //small blocks are nodes
+        void *p = resource.allocate(sizeof(void *), alignof(void *));
+        CHECK(List_free_node_count() == LIST_MAX_NUM_NODES - 1);
+        resource.deallocate(p, sizeof(void *), alignof(void *));
+        CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+
+        //bigger ones come from upstream
+        p = resource.allocate(64, 8);
+        CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+        resource.deallocate(p, 64, 8);
+
+        //a pmr container of small blocks
+        std::vector<std::pmr::vector<char>> outer;
+        std::pmr::polymorphic_allocator<char> allocator(&resource);
+        for(int i = 0; i < 4; ++i){
+            std::pmr::vector<char> inner(allocator);
+            inner.reserve(LIST_INLINE_MAX_SIZE);
+            inner.push_back('a' + i);
+            outer.push_back(std::move(inner));
+        }
+        CHECK(List_free_node_count() == LIST_MAX_NUM_NODES - 4);
+        CHECK(outer[3][0] == 'd');
+        outer.clear();
+        CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+    }
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+
+int main(int argCount, char *args[])
+{
+    s_test_elements();
+    s_test_move_only();
+    s_test_merge();
+    s_test_failures();
+    s_test_resource();
+
+    printf("********************************\n");
+    printf("           PASSED\n");
+    printf("********************************\n");
+    return 0;
+}
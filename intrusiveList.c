@@ -0,0 +1,333 @@
+#include <assert.h>
+#include <stddef.h>
+#include "intrusiveList.h"
+
+//centralized assert
+static void s_IList_assert(IList *pList)
+{
+    assert(pList != NULL);
+}
+
+//link pLink after prev, or at the start when prev is NULL
+static void s_link_after(IList *pList, IListLink *prev, IListLink *pLink)
+{
+    IListLink *next = prev ? prev->listNext : pList->head;
+
+    pLink->listPrev = prev;
+    pLink->listNext = next;
+
+    //if there is a prev, it should point to the link
+    //otherwise the link is the new head
+    if (prev)
+    {
+        prev->listNext = pLink;
+    }
+    else
+    {
+        pList->head = pLink;
+    }
+
+    //if there is a next, it should point back to the link
+    //otherwise the link is the new tail
+    if (next)
+    {
+        next->listPrev = pLink;
+    }
+    else
+    {
+        pList->tail = pLink;
+    }
+
+    pList->cur = pLink;
+    pList->isBeforeHead = false;
+    ++(pList->length);
+}
+
+// Makes pList an empty list. The IList itself is owned by the caller.
+void IList_init(IList *pList)
+{
+    s_IList_assert(pList);
+    pList->head = NULL;
+    pList->tail = NULL;
+    pList->cur = NULL;
+    pList->isBeforeHead = true;
+    pList->length = 0;
+}
+
+// Returns the number of links in pList.
+int IList_count(IList *pList)
+{
+    s_IList_assert(pList);
+    return pList->length;
+}
+
+// Returns the first link in pList and makes it the current one.
+// Returns NULL and sets current link to NULL if list is empty.
+IListLink *IList_first(IList *pList)
+{
+    s_IList_assert(pList);
+    pList->cur = pList->head;
+    //an empty list is before head
+    pList->isBeforeHead = !pList->head;
+    return pList->cur;
+}
+
+// Returns the last link in pList and makes it the current one.
+// Returns NULL and sets current link to NULL if list is empty.
+IListLink *IList_last(IList *pList)
+{
+    s_IList_assert(pList);
+    pList->cur = pList->tail;
+    pList->isBeforeHead = false;
+    return pList->cur;
+}
+
+// Advances pList's current link by one, and returns the new current link.
+// If this operation advances the current link beyond the end of the pList, NULL
+// is returned and the current link is set to be beyond end of pList.
+IListLink *IList_next(IList *pList)
+{
+    s_IList_assert(pList);
+    //if cur is not empty, move to next
+    if (pList->cur)
+    {
+        pList->cur = pList->cur->listNext;
+    }
+    //if before head, next is the head
+    else if (pList->isBeforeHead)
+    {
+        pList->cur = pList->head;
+    }
+    //beyond end stays beyond end
+    pList->isBeforeHead = false;
+    return pList->cur;
+}
+
+// Backs up pList's current link by one, and returns the new current link.
+// If this operation backs up the current link beyond the start of the pList, NULL
+// is returned and the current link is set to be before the start of pList.
+IListLink *IList_prev(IList *pList)
+{
+    s_IList_assert(pList);
+    //if cur is not empty, move to prev
+    if (pList->cur)
+    {
+        //if cur is head, the calling prev will point cur to before head
+        if (pList->cur == pList->head)
+        {
+            pList->isBeforeHead = true;
+        }
+        pList->cur = pList->cur->listPrev;
+    }
+    //if beyond end, prev is the tail
+    else if (!pList->isBeforeHead)
+    {
+        pList->cur = pList->tail;
+    }
+    return pList->cur;
+}
+
+// Returns the current link in pList.
+IListLink *IList_curr(IList *pList)
+{
+    s_IList_assert(pList);
+    return pList->cur;
+}
+
+// Links pLink into pList directly after the current link, and makes it the current one.
+void IList_add(IList *pList, IListLink *pLink)
+{
+    s_IList_assert(pList);
+    assert(pLink != NULL);
+
+    //cur is not null, link after it
+    if (pList->cur)
+    {
+        s_link_after(pList, pList->cur, pLink);
+    }
+    //before head, add to the start
+    else if (pList->isBeforeHead)
+    {
+        s_link_after(pList, NULL, pLink);
+    }
+    //beyond end, add to the end
+    else
+    {
+        s_link_after(pList, pList->tail, pLink);
+    }
+}
+
+// Links pLink into pList directly before the current link, and makes it the current one.
+void IList_insert(IList *pList, IListLink *pLink)
+{
+    s_IList_assert(pList);
+    assert(pLink != NULL);
+
+    //cur is not null, link before it
+    if (pList->cur)
+    {
+        s_link_after(pList, pList->cur->listPrev, pLink);
+    }
+    //before head, add to the start
+    else if (pList->isBeforeHead)
+    {
+        s_link_after(pList, NULL, pLink);
+    }
+    //beyond end, add to the end
+    else
+    {
+        s_link_after(pList, pList->tail, pLink);
+    }
+}
+
+// Links pLink at the end of pList, and makes it the current one.
+void IList_append(IList *pList, IListLink *pLink)
+{
+    s_IList_assert(pList);
+    assert(pLink != NULL);
+    s_link_after(pList, pList->tail, pLink);
+}
+
+// Links pLink at the front of pList, and makes it the current one.
+void IList_prepend(IList *pList, IListLink *pLink)
+{
+    s_IList_assert(pList);
+    assert(pLink != NULL);
+    s_link_after(pList, NULL, pLink);
+}
+
+// Return current link and unlink it from pList. Make the next link the current one.
+// If the current pointer is before the start of the pList, or beyond the end of the pList,
+// then do not change the pList and return NULL.
+IListLink *IList_remove(IList *pList)
+{
+    s_IList_assert(pList);
+
+    //nothing to remove
+    IListLink *pLink = pList->cur;
+    if (!pLink)
+    {
+        return NULL;
+    }
+
+    //if there is a next, link it back to the prev
+    //if not, cur is the tail, so prev will be the new tail
+    if (pLink->listNext)
+    {
+        pLink->listNext->listPrev = pLink->listPrev;
+    }
+    else
+    {
+        pList->tail = pLink->listPrev;
+    }
+
+    //if there is a prev, link it to the next
+    //if not, cur is the head, so next will be the new head
+    if (pLink->listPrev)
+    {
+        pLink->listPrev->listNext = pLink->listNext;
+    }
+    else
+    {
+        pList->head = pLink->listNext;
+    }
+
+    pList->cur = pLink->listNext;
+    --pList->length;
+
+    //the link no longer belongs to the list
+    pLink->listPrev = NULL;
+    pLink->listNext = NULL;
+    return pLink;
+}
+
+// Return last link and unlink it from pList. Make the new last link the current one.
+// Return NULL if pList is initially empty.
+IListLink *IList_trim(IList *pList)
+{
+    s_IList_assert(pList);
+
+    //remove the tail, then make the new tail current
+    pList->cur = pList->tail;
+    IListLink *pLink = IList_remove(pList);
+    pList->cur = pList->tail;
+    return pLink;
+}
+
+// Moves all links of pList2 to the end of pList1. The current pointer is set to the current
+// pointer of pList1. pList2 is left empty.
+void IList_concat(IList *pList1, IList *pList2)
+{
+    s_IList_assert(pList1);
+    s_IList_assert(pList2);
+    assert(pList1 != pList2);
+
+    //only perform concat if list 2 is not empty
+    if (pList2->head)
+    {
+        //link list 1 tail and list 2 head both ways
+        if (pList1->tail)
+        {
+            pList1->tail->listNext = pList2->head;
+            pList2->head->listPrev = pList1->tail;
+        }
+        else
+        {
+            pList1->head = pList2->head;
+        }
+        pList1->tail = pList2->tail;
+        pList1->length += pList2->length;
+    }
+
+    IList_init(pList2);
+}
+
+// Unlinks every link of pList, calling pLinkFreeFn (if not NULL) on each one after it is
+// unlinked, so it may free the struct that embeds it. pList is left empty.
+void IList_clear(IList *pList, ILIST_FREE_FN pLinkFreeFn)
+{
+    s_IList_assert(pList);
+
+    IListLink *pLink = pList->head;
+    while (pLink)
+    {
+        //read next before the link can be freed
+        IListLink *next = pLink->listNext;
+        pLink->listPrev = NULL;
+        pLink->listNext = NULL;
+        if (pLinkFreeFn)
+        {
+            (*pLinkFreeFn)(pLink);
+        }
+        pLink = next;
+    }
+
+    IList_init(pList);
+}
+
+// Search pList, starting at the current link, until the end is reached or a match is found.
+IListLink *IList_search(IList *pList, ILIST_COMPARATOR_FN pComparator, void *pComparisonArg)
+{
+    s_IList_assert(pList);
+    assert(pComparator != NULL);
+
+    //before head, start from the head
+    if (!pList->cur && pList->isBeforeHead)
+    {
+        pList->cur = pList->head;
+    }
+    pList->isBeforeHead = false;
+
+    //while cur is not NULL
+    while (pList->cur)
+    {
+        //compare cur with compartor and arg, if match then return
+        if ((*pComparator)(pList->cur, pComparisonArg))
+        {
+            return pList->cur;
+        }
+        pList->cur = pList->cur->listNext;
+    }
+    //not found, cur is beyond end
+    return NULL;
+}
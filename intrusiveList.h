@@ -0,0 +1,111 @@
+// Intrusive double linked list.
+// The caller embeds an IListLink in its own structs and links those directly, so
+// no node is taken from the List pool and adding can never fail. The functions
+// keep the same current item semantics as their List_* counterparts.
+//
+//     typedef struct {
+//         int value;
+//         IListLink link;
+//     } Item;
+//
+//     Item *pItem = ILIST_ENTRY(IList_curr(&list), Item, link);
+
+#ifndef _INTRUSIVE_LIST_H_
+#define _INTRUSIVE_LIST_H_
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct IListLink_s IListLink;
+struct IListLink_s {
+    IListLink* listPrev;
+    IListLink* listNext;
+};
+
+typedef struct IList_s IList;
+struct IList_s {
+    IListLink* head;
+    IListLink* tail;
+    IListLink* cur;
+
+    //use this boolean to distinguish before head and beyond end
+    bool isBeforeHead;
+    int length;
+};
+
+// Returns a pointer to the struct of type that embeds pLink as member.
+#define ILIST_ENTRY(pLink, type, member) \
+    ((type*)((char*)(pLink) - offsetof(type, member)))
+
+// Makes pList an empty list. The IList itself is owned by the caller.
+void IList_init(IList* pList);
+
+// Returns the number of links in pList.
+int IList_count(IList* pList);
+
+// Returns the first link in pList and makes it the current one.
+// Returns NULL and sets current link to NULL if list is empty.
+IListLink* IList_first(IList* pList);
+
+// Returns the last link in pList and makes it the current one.
+// Returns NULL and sets current link to NULL if list is empty.
+IListLink* IList_last(IList* pList);
+
+// Advances pList's current link by one, and returns the new current link.
+// If this operation advances the current link beyond the end of the pList, NULL
+// is returned and the current link is set to be beyond end of pList.
+IListLink* IList_next(IList* pList);
+
+// Backs up pList's current link by one, and returns the new current link.
+// If this operation backs up the current link beyond the start of the pList, NULL
+// is returned and the current link is set to be before the start of pList.
+IListLink* IList_prev(IList* pList);
+
+// Returns the current link in pList.
+IListLink* IList_curr(IList* pList);
+
+// Links pLink into pList directly after the current link, and makes it the current one.
+// If the current pointer is before the start of the pList, the link is added at the start. If
+// the current pointer is beyond the end of the pList, the link is added at the end.
+// pLink must not be in any list.
+void IList_add(IList* pList, IListLink* pLink);
+
+// Links pLink into pList directly before the current link, and makes it the current one.
+// If the current pointer is before the start of the pList, the link is added at the start.
+// If the current pointer is beyond the end of the pList, the link is added at the end.
+// pLink must not be in any list.
+void IList_insert(IList* pList, IListLink* pLink);
+
+// Links pLink at the end of pList, and makes it the current one.
+void IList_append(IList* pList, IListLink* pLink);
+
+// Links pLink at the front of pList, and makes it the current one.
+void IList_prepend(IList* pList, IListLink* pLink);
+
+// Return current link and unlink it from pList. Make the next link the current one.
+// If the current pointer is before the start of the pList, or beyond the end of the pList,
+// then do not change the pList and return NULL.
+IListLink* IList_remove(IList* pList);
+
+// Return last link and unlink it from pList. Make the new last link the current one.
+// Return NULL if pList is initially empty.
+IListLink* IList_trim(IList* pList);
+
+// Moves all links of pList2 to the end of pList1. The current pointer is set to the current
+// pointer of pList1. pList2 is left empty.
+void IList_concat(IList* pList1, IList* pList2);
+
+// Unlinks every link of pList, calling pLinkFreeFn (if not NULL) on each one after it is
+// unlinked, so it may free the struct that embeds it. pList is left empty.
+typedef void (*ILIST_FREE_FN)(IListLink* pLink);
+void IList_clear(IList* pList, ILIST_FREE_FN pLinkFreeFn);
+
+// Search pList, starting at the current link, until the end is reached or a match is found.
+// The comparator returns true if pLink matches pComparisonArg.
+// If a match is found, the current pointer is left at the matched link and it is returned.
+// If no match is found, the current pointer is left beyond the end of the list and NULL is
+// returned. If the current pointer is before the start of the pList, then start searching
+// from the first link in the list (if any).
+typedef bool (*ILIST_COMPARATOR_FN)(IListLink* pLink, void* pComparisonArg);
+IListLink* IList_search(IList* pList, ILIST_COMPARATOR_FN pComparator, void* pComparisonArg);
+
+#endif
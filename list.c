@@ -1,45 +1,492 @@
+#define _GNU_SOURCE
 #include <assert.h>
+#include <fcntl.h>
+#ifdef LIST_ASYNC_FREE
+#include <pthread.h>
+#endif
+#include <sched.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include "list.h"
+#include "listRecord.h"
+#include "listTrace.h"
 
-//static allocated head array
-static List s_heads[LIST_MAX_NUM_HEADS];
-//static allocated node array
-static Node s_nodes[LIST_MAX_NUM_NODES];
-//stack head to the head array
-static List *s_pFreeHead = s_heads;
-//stack head to the node array
-static Node *s_pFreeNode = s_nodes;
-//static boolean to indicate the whether stack has been init'd
-static bool s_hasInit = 0;
-
-//init the stack
+//number of 64 bit words in the node bitmap
+#define NODE_MAP_WORDS ((LIST_MAX_NUM_NODES + 63) / 64)
+
+//maximum number of index levels above the list of a sorted index
+#define SKIP_MAX_LEVELS 16
+//index nodes are only taken while more nodes than this are free
+#define SKIP_RESERVE_NODES (LIST_MAX_NUM_NODES / 8)
+
+//first word of a file written by List_save, and its format version
+#define SAVE_MAGIC 0x54534c44u
+#define SAVE_VERSION 1u
+//saved index of the current item when cur is before head or beyond end
+#define SAVE_BEFORE_HEAD 0xffffffffu
+#define SAVE_BEYOND_END 0xfffffffeu
+
+//first word of a pool attached from a file, and its layout version
+#define POOL_MAGIC 0x4c4f4f50u
+#define POOL_VERSION 7u
+//smallest page size, and the size of the huge pages asked for by LIST_POOL_HUGE_PAGES
+#define POOL_PAGE_SIZE 4096
+#define POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+//memory policy of mbind placing pages on a NUMA node, as long as it has memory left
+#define POOL_MPOL_PREFERRED 1
+
+#if LIST_SMALL_SIZE < 0 || LIST_SMALL_SIZE > 64 || (LIST_SMALL_SIZE && 64 % LIST_SMALL_SIZE)
+#error "LIST_SMALL_SIZE must divide 64, the home nodes of a head share a word of the node bitmap"
+#endif
+//nodes at the start of the node array that are home nodes, in whole bitmap words,
+//the ones past the home nodes of the last head are only lent out like the others
+#define SMALL_NODES ((LIST_MAX_NUM_HEADS * LIST_SMALL_SIZE + 63) / 64 * 64 < LIST_MAX_NUM_NODES ? \
+                     (LIST_MAX_NUM_HEADS * LIST_SMALL_SIZE + 63) / 64 * 64 : LIST_MAX_NUM_NODES)
+
+#if defined(LIST_ASYNC_FREE) && !defined(LIST_THREAD_SAFE)
+#error "LIST_ASYNC_FREE needs LIST_THREAD_SAFE, the reclaimer gives nodes back from its own thread"
+#endif
+
+#ifdef LIST_SNAPSHOT
+#ifdef LIST_THREAD_SAFE
+#error "LIST_SNAPSHOT cannot be combined with LIST_THREAD_SAFE"
+#endif
+//epoch of a snapshot emptied by s_snapshot_break, newer than any node
+#define SNAPSHOT_BROKEN (UINT32_MAX - 1)
+//stamp of a node taken out of a list while snapshots read its versions, see s_snapshot_park
+#define SNAPSHOT_PARKED UINT32_MAX
+#endif
+
+//a range of the node array with its own free count and high-water mark,
+//threads take nodes from the partition of their NUMA node first
+typedef struct NodePartition_s NodePartition;
+struct NodePartition_s {
+    //first node of the partition, and one past its last node
+    size_t start;
+    size_t end;
+    //nodes from this one on have never been used, they are handed out
+    //in order once no recycled one is left, so nothing has to be set up in advance
+    //and only the pages of nodes that were actually used are ever touched
+    size_t highWater;
+    //number of free nodes, recycled ones plus those never used
+    size_t numFree;
+    //number of those that are home nodes, always 0 without LIST_SMALL_SIZE
+    size_t numFreeHome;
+    //lowest word of the node bitmap past the home nodes that may still have a set bit,
+    //and the same for the words of the home nodes
+    size_t mapHint;
+    size_t homeHint;
+    //NUMA node the memory of the partition is placed on
+    int numaNode;
+};
+
+//everything the heads and nodes are made of, kept in one block
+//so the whole pool can be mapped from a file by List_pool_attach
+//links are refs relative to the block, so it can be mapped anywhere
+typedef struct ListPool_s ListPool;
+struct ListPool_s {
+    //checked when a pool file is attached again,
+    //a pool made with other sizes cannot be used as is
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numHeads;
+    uint32_t numNodes;
+    uint32_t inlineMaxSize;
+    uint32_t smallSize;
+    //size of the whole pool, heads and nodes grow with some of the build flags
+    uint64_t poolSize;
+    //boolean to indicate the whether stack has been init'd
+    bool hasInit;
+    //stack head to the recycled heads, slot of the top free head plus one
+    uint32_t freeHead;
+    //heads from this slot on have never been used, like the nodes of a partition
+    uint32_t headHighWater;
+    //number of free nodes in all partitions that no one has reserved yet,
+    //see s_reserve_nodes
+    size_t numFreeNodes;
+    //number of nodes the sorted indexes hold, which are given back when the pool runs out
+    size_t numSkipNodes;
+    //partitions of the node array, each one but the last partitionSize nodes long,
+    //which is a multiple of 64 so no bitmap word is shared by two partitions
+    uint32_t numPartitions;
+    size_t partitionSize;
+    NodePartition partitions[LIST_MAX_NUM_PARTITIONS];
+#ifdef LIST_SNAPSHOT
+    //epoch the next snapshot is made in, and a node changed in it gets as its stamp
+    uint32_t epoch;
+    //epoch of the newest live snapshot, nodes with a stamp up to it are kept
+    //as they are before they change, 0 while there is no live snapshot
+    uint32_t snapshotEpoch;
+    //number of live snapshots
+    uint32_t numSnapshots;
+#endif
+    //free slot bitmap of the recycled nodes, below the high-water marks, a set bit means
+    //the node is free so 64 nodes can be scanned at once without touching the nodes themselves
+    uint64_t nodeFreeMap[NODE_MAP_WORDS];
+    //head array
+    List heads[LIST_MAX_NUM_HEADS];
+    //node array, starting on a page so partitions can be placed page by page
+    Node nodes[LIST_MAX_NUM_NODES] __attribute__((aligned(POOL_PAGE_SIZE)));
+};
+
+//static allocated pool, used while no pool file is attached
+static ListPool s_staticPool;
+//pool all List_* functions work on
+static ListPool *s_pool = &s_staticPool;
+//size of the mapping of a pool attached or mapped by List_pool_attach or List_pool_map,
+//and of the pages it was mapped with
+static size_t s_poolMapSize = 0;
+static size_t s_poolPageSize = POOL_PAGE_SIZE;
+
+//names of the List_* functions, indexed by ListOp
+static const char *s_opNames[LIST_NUM_OPS] = {
+    "List_create",
+    "List_count",
+    "List_free_node_count",
+    "List_first",
+    "List_last",
+    "List_next",
+    "List_prev",
+    "List_curr",
+    "List_add",
+    "List_insert",
+    "List_append",
+    "List_prepend",
+    "List_append_all",
+    "List_remove",
+    "List_concat",
+    "List_free",
+    "List_trim",
+    "List_search",
+    "List_sort",
+    "List_merge",
+    "List_insert_sorted",
+    "List_create_inline",
+    "List_save",
+    "List_load",
+    "List_pool_attach",
+    "List_pool_detach",
+    "List_id",
+    "List_from_id",
+    "List_first_ref",
+    "List_last_ref",
+    "List_next_ref",
+    "List_prev_ref",
+    "List_ref_item",
+    "List_pool_map",
+    "List_pool_placement",
+    "List_rcu_search",
+    "List_rcu_synchronize",
+    "List_push_back",
+    "List_push_front",
+    "List_pop_back",
+    "List_pop_front",
+    "List_remove_if",
+    "List_item_ref",
+    "List_seek_ref",
+    "List_snapshot",
+    "List_snapshot_is_valid",
+    "List_snapshot_release",
+    "List_clone",
+    "List_clone_range",
+    "List_free_async",
+    "List_free_async_flush",
+    "List_free_async_stop",
+};
+
+#ifdef LIST_STATS
+//pool statistics, all updates are relaxed atomics
+static ListStats s_stats;
+
+//add delta to an in use counter and raise its high-water mark if needed
+static void s_stat_use(int *pInUse, int *pHighWater, int delta)
+{
+    int inUse = __atomic_add_fetch(pInUse, delta, __ATOMIC_RELAXED);
+    int highWater = __atomic_load_n(pHighWater, __ATOMIC_RELAXED);
+    while (inUse > highWater &&
+           !__atomic_compare_exchange_n(pHighWater, &highWater, inUse, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+//recount the nodes and heads in use after switching to another pool
+static void s_stat_sync()
+{
+    int nodes = s_pool->hasInit ? LIST_MAX_NUM_NODES - (int)s_pool->numFreeNodes : 0;
+    int heads = 0;
+    for (size_t i = 0; i < s_pool->headHighWater; ++i)
+    {
+        heads += !s_pool->heads[i].isFree;
+    }
+    s_stat_use(&s_stats.nodesInUse, &s_stats.nodesHighWater,
+               nodes - __atomic_load_n(&s_stats.nodesInUse, __ATOMIC_RELAXED));
+    s_stat_use(&s_stats.headsInUse, &s_stats.headsHighWater,
+               heads - __atomic_load_n(&s_stats.headsInUse, __ATOMIC_RELAXED));
+}
+
+//count a call to a List_* function
+#define STAT_OP(op) __atomic_fetch_add(&s_stats.opCounts[op], 1, __ATOMIC_RELAXED)
+//count a failed allocation, counter is nodeFailures or headFailures
+#define STAT_FAIL(counter) __atomic_fetch_add(&s_stats.counter, 1, __ATOMIC_RELAXED)
+//count nodes taken out of (positive) or returned to (negative) the node pool
+#define STAT_NODES(delta) s_stat_use(&s_stats.nodesInUse, &s_stats.nodesHighWater, (delta))
+//count heads taken out of (positive) or returned to (negative) the head pool
+#define STAT_HEADS(delta) s_stat_use(&s_stats.headsInUse, &s_stats.headsHighWater, (delta))
+//recount the in use counters after switching pools
+#define STAT_SYNC() s_stat_sync()
+#else
+#define STAT_OP(op)
+#define STAT_FAIL(counter)
+#define STAT_NODES(delta)
+#define STAT_HEADS(delta)
+#define STAT_SYNC()
+#endif
+
+#ifdef LIST_TRACE
+//time the enclosing List_* call until it returns, whichever return it takes
+#define TRACE_OP(op) ListTraceScope traceScope __attribute__((cleanup(List_trace_end))) = List_trace_begin(op)
+#else
+#define TRACE_OP(op)
+#endif
+
+#ifdef LIST_RECORD
+//mark the enclosing List_* call until it returns, so calls it makes are not recorded
+#define RECORD_SCOPE() ListRecordScope recordScope __attribute__((cleanup(List_record_end))) = List_record_begin()
+//slot of a list in a recording
+#define RECORD_ID(pList) ((pList) ? (uint32_t)((pList) - s_pool->heads) : LIST_RECORD_NO_LIST)
+//record the call with its list, a second list or a number, and an item
+#define RECORD(op, pList, other, pItem) \
+    List_record_call((op), RECORD_ID(pList), (other), List_record_token((pList), (pItem)))
+//add an item to the tokens of the call recorded next
+#define RECORD_ITEM(pList, pItem) List_record_push(List_record_token((pList), (pItem)))
+//add count items to the tokens of the call recorded next
+#define RECORD_ITEMS(pList, pItems, count)                          \
+    for (int recordIndex = 0; recordIndex < (count); ++recordIndex) \
+    RECORD_ITEM((pList), (pItems)[recordIndex])
+#else
+#define RECORD_SCOPE()
+#define RECORD_ID(pList)
+#define RECORD(op, pList, other, pItem)
+#define RECORD_ITEM(pList, pItem)
+#define RECORD_ITEMS(pList, pItems, count)
+#endif
+
+//hooks run on entry to every public List_* function
+#define LIST_ENTER(op) \
+    STAT_OP(op);       \
+    TRACE_OP(op);      \
+    RECORD_SCOPE()
+
+#ifdef LIST_THREAD_SAFE
+//a test and test-and-set spinlock on a cache line of its own,
+//so the locks of different lists or partitions never share a line
+typedef struct SpinLock_s SpinLock;
+struct SpinLock_s {
+    bool isLocked;
+} __attribute__((aligned(64)));
+
+//times a waiting thread spins before it starts yielding its cpu to the holder
+#define SPIN_LIMIT 64
+
+//lock of the head pool
+static SpinLock s_headPoolLock;
+//locks of the node pool, one for each partition
+static SpinLock s_nodePoolLocks[LIST_MAX_NUM_PARTITIONS];
+//locks taken by the List_ts_* functions, one for each head
+static SpinLock s_listLocks[LIST_MAX_NUM_HEADS];
+//locks of the sorted indexes, one for each head, so a thread that runs out of nodes
+//can drop the index of a list another thread works on
+static SpinLock s_skipLocks[LIST_MAX_NUM_HEADS];
+
+static void s_lock(SpinLock *lock)
+{
+    int spins = 0;
+    while (__atomic_exchange_n(&lock->isLocked, true, __ATOMIC_ACQUIRE))
+    {
+        //wait with plain loads, so the line stays shared until it is unlocked
+        while (__atomic_load_n(&lock->isLocked, __ATOMIC_RELAXED))
+        {
+            if (++spins > SPIN_LIMIT)
+            {
+                sched_yield();
+            }
+        }
+    }
+}
+
+static void s_unlock(SpinLock *lock)
+{
+    __atomic_store_n(&lock->isLocked, false, __ATOMIC_RELEASE);
+}
+
+//take and give back one of the locks above
+#define TS_LOCK(lock) s_lock(lock)
+//lock of a node pool partition
+#define PARTITION_LOCK(part) (s_nodePoolLocks + ((part) - s_pool->partitions))
+//lock of the sorted index of a list
+#define SKIP_LOCK(pList) (s_skipLocks + ((pList) - s_pool->heads))
+#define TS_UNLOCK(lock) s_unlock(lock)
+#else
+#define TS_LOCK(lock)
+#define TS_UNLOCK(lock)
+#endif
+
+#ifdef LIST_RCU
+//store a link readers may follow, after everything it leads to has been written
+#define LINK_PUBLISH(link, ref) __atomic_store_n(&(link), (ref), __ATOMIC_RELEASE)
+//load a link as a reader, seeing everything written before it was published
+#define LINK_READ(link) __atomic_load_n(&(link), __ATOMIC_ACQUIRE)
+
+//a reader slot on a cache line of its own, so readers never write to a shared line
+typedef struct RcuSlot_s RcuSlot;
+struct RcuSlot_s {
+    //epoch the reader entered its read-side critical section in, 0 while it is outside
+    uint64_t epoch;
+    //whether a thread has claimed the slot
+    bool isTaken;
+} __attribute__((aligned(64)));
+
+//reader slots, claimed by threads on their first List_rcu_read_lock
+static RcuSlot s_rcuSlots[LIST_RCU_MAX_READERS];
+//number of claimed slots, while it is 0 there can be no reader
+static int s_rcuNumReaders = 0;
+//current epoch, starts at 1 as 0 marks a reader outside its critical section
+static uint64_t s_rcuEpoch = 1;
+//slot of the calling thread, -1 until it claims one, and its read lock nesting depth
+static __thread int s_rcuSlot = -1;
+static __thread int s_rcuDepth = 0;
+//nodes taken out of lists since the last grace period started, chained through listPrev
+static NodeRef s_rcuRetired = 0;
+static size_t s_rcuNumRetired = 0;
+//nodes waiting for the end of the grace period of s_rcuPendingEpoch
+static NodeRef s_rcuPending = 0;
+static uint64_t s_rcuPendingEpoch = 0;
+#ifdef LIST_THREAD_SAFE
+//guards the retired and pending nodes, which the writers of different lists share
+static SpinLock s_rcuLock;
+#endif
+#else
+#define LINK_PUBLISH(link, ref) ((link) = (ref))
+#define LINK_READ(link) (link)
+#endif
+
+//node a ref stands for, NULL for ref 0
+static inline Node *s_node(NodeRef ref)
+{
+    return ref ? s_pool->nodes + ref - 1 : NULL;
+}
+
+//ref of a node, 0 for NULL
+static inline NodeRef s_ref(Node *node)
+{
+    return node ? (NodeRef)(node - s_pool->nodes) + 1 : 0;
+}
+
+//head a stack link stands for, NULL for 0
+static inline List *s_head(uint32_t link)
+{
+    return link ? s_pool->heads + link - 1 : NULL;
+}
+
+//one past the last home node of a partition, its start if it has none
+static inline size_t s_home_end(NodePartition *part)
+{
+    return SMALL_NODES < part->start ? part->start : SMALL_NODES < part->end ? SMALL_NODES : part->end;
+}
+
+//make all nodes of a partition free, the home nodes go into the bitmap
+//so their heads can pick them by bit, the others are never used
+static void s_reset_partition(NodePartition *part)
+{
+    part->highWater = s_home_end(part);
+    part->numFree = part->end - part->start;
+    part->numFreeHome = part->highWater - part->start;
+    part->mapHint = part->highWater / 64;
+    part->homeHint = part->start / 64;
+    for (size_t index = part->start; index < part->highWater; ++index)
+    {
+        Node *node = s_pool->nodes + index;
+        node->data = NULL;
+        node->listPrev = 0;
+        node->listNext = 0;
+#ifdef LIST_SNAPSHOT
+        node->shadow = 0;
+#endif
+        s_pool->nodeFreeMap[index / 64] |= (uint64_t)1 << (index % 64);
+    }
+}
+
+//make the node array one partition, on no particular NUMA node
+static void s_init_partitions()
+{
+    s_pool->numPartitions = 1;
+    s_pool->partitionSize = LIST_MAX_NUM_NODES;
+    s_pool->partitions[0].start = 0;
+    s_pool->partitions[0].end = LIST_MAX_NUM_NODES;
+    s_pool->partitions[0].highWater = 0;
+    s_pool->partitions[0].numaNode = -1;
+}
+
+//init the pool, or reset it to empty after it was used, in O(1) plus the used part
+//and the home nodes
 static void s_init()
 {
-    //push all head into the head stack
-    //and set data to inital value
-    for (size_t i = 0; i < LIST_MAX_NUM_HEADS; ++i)
+    s_pool->magic = POOL_MAGIC;
+    s_pool->version = POOL_VERSION;
+    s_pool->numHeads = LIST_MAX_NUM_HEADS;
+    s_pool->numNodes = LIST_MAX_NUM_NODES;
+    s_pool->inlineMaxSize = LIST_INLINE_MAX_SIZE;
+    s_pool->smallSize = LIST_SMALL_SIZE;
+    s_pool->poolSize = sizeof(ListPool);
+    //a pool split up by List_pool_map keeps its partitions
+    if (!s_pool->numPartitions)
+    {
+        s_init_partitions();
+    }
+
+    //heads and nodes are set up when they are first handed out,
+    //only the bits of the recycled nodes have to be cleared
+    for (size_t i = 0; i < s_pool->numPartitions; ++i)
+    {
+        NodePartition *part = s_pool->partitions + i;
+        memset(s_pool->nodeFreeMap + part->start / 64, 0,
+               ((part->highWater + 63) / 64 - part->start / 64) * sizeof(uint64_t));
+        s_reset_partition(part);
+    }
+    s_pool->freeHead = 0;
+    s_pool->headHighWater = 0;
+    s_pool->numFreeNodes = LIST_MAX_NUM_NODES;
+    s_pool->numSkipNodes = 0;
+#ifdef LIST_SNAPSHOT
+    s_pool->epoch = 1;
+    s_pool->snapshotEpoch = 0;
+    s_pool->numSnapshots = 0;
+#endif
+    s_pool->hasInit = true;
+}
+
+//item of a list node: the data pointer, or the inline bytes for inline lists
+static inline void *s_item(List *pList, Node *node)
+{
+    return pList->itemSize ? node->inlineData : node->data;
+}
+
+//store pItem into a list node, copying the value for inline lists
+static inline void s_set_item(List *pList, Node *node, void *pItem)
+{
+    if (pList->itemSize)
     {
-        s_heads[i].head = NULL;
-        s_heads[i].tail = NULL;
-        s_heads[i].cur = NULL;
-        s_heads[i].isBeforeHead = 1;
-        s_heads[i].length = 0;
-        s_heads[i].stackNext = s_heads + i + 1;
-        s_heads[i].isFree = true;
+        memcpy(node->inlineData, pItem, pList->itemSize);
     }
-    s_heads[LIST_MAX_NUM_HEADS - 1].stackNext = NULL;
-    ///push all node into the node stack
-    //and set data to inital value
-    for (size_t i = 0; i < LIST_MAX_NUM_NODES; ++i)
+    else
     {
-        s_nodes[i].data = NULL;
-        s_nodes[i].listPrev = NULL;
-        s_nodes[i].listNext = NULL;
-        s_nodes[i].stackNext = s_nodes + i + 1;
-        s_nodes[i].isFree = true;
+        node->data = pItem;
     }
-    s_nodes[LIST_MAX_NUM_NODES - 1].stackNext = NULL;
 }
 
 //push a head into the head stack
@@ -51,550 +498,3589 @@ static void s_push_free_head(List *head)
     {
         return;
     }
+    TS_LOCK(&s_headPoolLock);
     //erase data just to be safe
-    head->head = NULL;
-    head->tail = NULL;
-    head->cur = NULL;
+    head->head = 0;
+    head->tail = 0;
+    head->cur = 0;
     head->isBeforeHead = true;
     head->length = 0;
+    head->skipIndex = 0;
+    head->itemSize = 0;
+#ifdef LIST_SNAPSHOT
+    head->snapshotEpoch = 0;
+#endif
     head->isFree = true;
-    head->stackNext = s_pFreeHead;
-    s_pFreeHead = head;
+    head->stackNext = s_pool->freeHead;
+    s_pool->freeHead = head - s_pool->heads + 1;
+    TS_UNLOCK(&s_headPoolLock);
+    STAT_HEADS(-1);
 }
 
-//pop a head out of head stack
+//pop a head out of head stack, or take a never used one if it is empty
+//caller must hold the head pool lock
 static List *s_pop_free_head()
 {
-    List *free = s_pFreeHead;
+    List *free = s_head(s_pool->freeHead);
     if (free != NULL)
     {
-        s_pFreeHead = s_pFreeHead->stackNext;
-        free->isFree = false;
-        free->stackNext = NULL;
+        s_pool->freeHead = free->stackNext;
     }
-    return free;
-}
-
-//push a node into the node stack
-static void s_push_free_node(Node *node)
-{
-    //stack guard to prevent pushing existing node
-    //which will corrupt the linked list linkage
-    if (node->isFree)
+    else if (s_pool->headHighWater < LIST_MAX_NUM_HEADS)
     {
-        return;
+        //set data to inital value
+        free = s_pool->heads + s_pool->headHighWater++;
+        free->head = 0;
+        free->tail = 0;
+        free->cur = 0;
+        free->isBeforeHead = true;
+        free->length = 0;
+        free->skipIndex = 0;
+        free->itemSize = 0;
+#ifdef LIST_SNAPSHOT
+        free->snapshotEpoch = 0;
+#endif
     }
-    //erase the data just to be safe
-    node->data = NULL;
-    node->listNext = NULL;
-    node->listPrev = NULL;
-    node->isFree = true;
-    node->stackNext = s_pFreeNode;
-    s_pFreeNode = node;
-}
-
-//pop a node out of node stack
-static Node *s_pop_free_node()
-{
-    Node *free = s_pFreeNode;
-    if (free != NULL)
+    else
     {
-        s_pFreeNode = s_pFreeNode->stackNext;
-        free->isFree = false;
-        free->stackNext = NULL;
+        return NULL;
     }
+    free->isFree = false;
+    free->stackNext = 0;
+    STAT_HEADS(1);
     return free;
 }
 
-//when adding or inserting to a list with null cur,
-//do a special insert logic
-static void s_special_insert(List *pList, Node *new)
+//partition a node belongs to
+static inline NodePartition *s_partition_of(size_t index)
 {
-    //calling this function when cur is not null is not allowed
-    assert(pList->cur == NULL);
+    return s_pool->partitions + index / s_pool->partitionSize;
+}
 
-    //if before head, add the item to start
-    if (pList->isBeforeHead)
+//partition to take nodes from first, the one on the NUMA node the calling thread runs on
+static NodePartition *s_home_partition()
+{
+    if (s_pool->numPartitions == 1)
     {
-        new->listNext = pList->head;
-        new->listPrev = NULL;
-
-        //if there was a head, head should point back to the added item
-        if (pList->head)
-        {
-            pList->head->listPrev = new;
-        }
-        //there was no head, the list was empty
-        //the new item should also be the tail
-        else
-        {
-            pList->tail = new;
-        }
-
-        //let the item be the new head
-        pList->head = new;
+        return s_pool->partitions;
     }
-    //current is NULL and not before head, means it should be after tail
-    //add it to the tail
-    else
+    unsigned int cpu, numaNode;
+    if (getcpu(&cpu, &numaNode) == 0)
     {
-        new->listPrev = pList->tail;
-        new->listNext = NULL;
-
-        //if there was a tail, tail should point to the added item
-        if (pList->tail)
+        for (size_t i = 0; i < s_pool->numPartitions; ++i)
         {
-            pList->tail->listNext = new;
+            if (s_pool->partitions[i].numaNode == (int)numaNode)
+            {
+                return s_pool->partitions + i;
+            }
         }
-        //there was no tail, the list was empty
-        //the new item should also be the head
-        else
-        {
-            pList->head = new;
-        }
-
-        //let the item be the new tail
-        pList->tail = new;
     }
+    return s_pool->partitions;
 }
 
-//centralized assert
-static void s_List_assert(List *pList){
-    //the given pointer must not be NULL or in the pool
-    assert(pList != NULL && !pList->isFree);
+//partition to take nodes from after part, going round all of them
+static inline NodePartition *s_next_partition(NodePartition *part)
+{
+    ++part;
+    return part == s_pool->partitions + s_pool->numPartitions ? s_pool->partitions : part;
 }
 
-// Makes a new, empty list, and returns its reference on success.
-// Returns a NULL pointer on failure.
-List *List_create()
+//number of free nodes no one has reserved yet
+static inline size_t s_num_free_nodes()
+{
+    return __atomic_load_n(&s_pool->numFreeNodes, __ATOMIC_RELAXED);
+}
+
+//reserve count free nodes, or none if there are not that many,
+//reserved nodes are then taken out of whichever partitions have them
+//so with LIST_THREAD_SAFE no lock has to be held across all partitions
+static bool s_reserve_nodes(size_t count)
 {
-    //O(n) set-up at the very first time
-    if (!s_hasInit)
+#ifdef LIST_THREAD_SAFE
+    size_t numFree = s_num_free_nodes();
+    do
     {
-        s_init();
-        s_hasInit = true;
+        if (count > numFree)
+        {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&s_pool->numFreeNodes, &numFree, numFree - count,
+                                          true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#else
+    if (count > s_pool->numFreeNodes)
+    {
+        return false;
     }
-
-    //return the top of the head stack
-    return s_pop_free_head();
+    s_pool->numFreeNodes -= count;
+#endif
+    return true;
 }
 
-// Returns the number of items in pList.
-int List_count(List *pList)
+//make nodes given back to a partition available to s_reserve_nodes again
+static inline void s_unreserve_nodes(size_t count)
 {
-    s_List_assert(pList);
-    return pList->length;
+#ifdef LIST_THREAD_SAFE
+    __atomic_add_fetch(&s_pool->numFreeNodes, count, __ATOMIC_RELAXED);
+#else
+    s_pool->numFreeNodes += count;
+#endif
 }
 
-// Returns a pointer to the first item in pList and makes the first item the current item.
-// Returns NULL and sets current item to NULL if list is empty.
-void *List_first(List *pList)
+//set the bit of a node in the node bitmap of its partition, whose lock the caller holds
+//returns false for a node that is free already
+static bool s_put_free_node(NodePartition *part, Node *node)
 {
-    s_List_assert(pList);
-    //head is not null, then return head
-    if (pList->head)
+    size_t index = node - s_pool->nodes;
+    uint64_t bit = (uint64_t)1 << (index % 64);
+    //bitmap guard to prevent pushing a free node twice
+    //which will corrupt the free count, never used nodes are free already
+    if (index >= part->highWater || (s_pool->nodeFreeMap[index / 64] & bit))
     {
-        pList->cur = pList->head;
-        return pList->cur->data;
+        return false;
     }
-    //head is null means list is empty
-    //then cur should be before head
-    else
+    //erase the data just to be safe
+    node->data = NULL;
+    node->listNext = 0;
+    node->listPrev = 0;
+    s_pool->nodeFreeMap[index / 64] |= bit;
+    ++part->numFree;
+    //the freed node may be below the first word with a free node
+    if (index < SMALL_NODES)
     {
-        pList->cur = NULL;
-        pList->isBeforeHead = true;
-        return NULL;
+        ++part->numFreeHome;
+        if (index / 64 < part->homeHint)
+        {
+            part->homeHint = index / 64;
+        }
     }
+    else if (index / 64 < part->mapHint)
+    {
+        part->mapHint = index / 64;
+    }
+    return true;
 }
 
-// Returns a pointer to the last item in pList and makes the last item the current item.
-// Returns NULL and sets current item to NULL if list is empty.
-void *List_last(List *pList)
+//push a node back into the node bitmap
+static void s_push_free_node(Node *node)
 {
-    s_List_assert(pList);
+    NodePartition *part = s_partition_of(node - s_pool->nodes);
+    TS_LOCK(PARTITION_LOCK(part));
+    bool isPut = s_put_free_node(part, node);
+    TS_UNLOCK(PARTITION_LOCK(part));
+    if (isPut)
+    {
+        s_unreserve_nodes(1);
+        STAT_NODES(-1);
+    }
+}
 
-    //no matter what, cur should no longer before head
-    pList->isBeforeHead = false;
-    //tail is not null return tail
-    if (pList->tail)
+//push a chain of nodes linked through listPrev back into the node bitmap,
+//taking the lock of a partition once for each run of nodes in it
+static void s_push_free_chain(Node *node)
+{
+    size_t count = 0;
+    NodePartition *part = NULL;
+    while (node)
     {
-        pList->cur = pList->tail;
-        return pList->cur->data;
+        Node *next = s_node(node->listPrev);
+        NodePartition *nodePart = s_partition_of(node - s_pool->nodes);
+        if (nodePart != part)
+        {
+            if (part)
+            {
+                TS_UNLOCK(PARTITION_LOCK(part));
+            }
+            part = nodePart;
+            TS_LOCK(PARTITION_LOCK(part));
+        }
+        count += s_put_free_node(part, node);
+        node = next;
     }
-    //else list is empty,
-    else
+    if (part)
     {
-        pList->cur = NULL;
-        return NULL;
+        TS_UNLOCK(PARTITION_LOCK(part));
     }
+    s_unreserve_nodes(count);
+    STAT_NODES(-(int)count);
 }
 
-// Advances pList's current item by one, and returns a pointer to the new current item.
-// If this operation advances the current item beyond the end of the pList, a NULL pointer
-// is returned and the current item is set to be beyond end of pList.
-void *List_next(List *pList)
+#ifdef LIST_RCU
+//whether every reader that entered before epoch has left its critical section
+static bool s_rcu_grace_over(uint64_t epoch)
 {
-    s_List_assert(pList);
-    //if cur is not empty, return next
-    if (pList->cur)
+    for (size_t i = 0; i < LIST_RCU_MAX_READERS; ++i)
     {
-        pList->cur = pList->cur->listNext;
-        pList->isBeforeHead = false;
-    }
-    //if current is empty, need to know if current is beyond head or after tail
-    else
-    {
-        //if beyond head, next should be point to head
-        if (pList->isBeforeHead)
-        {
-            pList->cur = pList->head;
-            pList->isBeforeHead = false;
-        }
-        //current is empty and not beyond head, means it should be after tail
-        else
+        uint64_t readerEpoch = __atomic_load_n(&s_rcuSlots[i].epoch, __ATOMIC_SEQ_CST);
+        if (readerEpoch && readerEpoch < epoch)
         {
-            return NULL;
+            return false;
         }
     }
-    return List_curr(pList);
+    return true;
 }
 
-// Backs up pList's current item by one, and returns a pointer to the new current item.
-// If this operation backs up the current item beyond the start of the pList, a NULL pointer
-// is returned and the current item is set to be before the start of pList.
-void *List_prev(List *pList)
+//recycle the pending nodes if their grace period is over
+static void s_rcu_recycle_pending()
 {
-    s_List_assert(pList);
-    //if cur is not empty, return prev
-    if (pList->cur)
+    if (s_rcuPending && s_rcu_grace_over(s_rcuPendingEpoch))
     {
-        //if cur is head, the calling prev will point cur to before head
-        if (pList->cur == pList->head)
+        while (s_rcuPending)
         {
-            pList->isBeforeHead = true;
+            Node *node = s_node(s_rcuPending);
+            s_rcuPending = node->listPrev;
+            s_push_free_node(node);
         }
-        pList->cur = pList->cur->listPrev;
     }
-    //if current is NULL, need to know if current is beyond head or after tail
-    else
+}
+
+//recycle the pending nodes once their grace period is over,
+//then start a grace period for the nodes retired since
+//caller must hold the rcu lock
+static void s_rcu_poll()
+{
+    s_rcu_recycle_pending();
+    if (!s_rcuPending && s_rcuRetired)
     {
-        //if beyond head, do nothing
-        if (pList->isBeforeHead)
-        {
-            return NULL;
-        }
-        //current is NULL and not beyond head, means it should be after tail
-        //so prev should be tail
-        else
-        {
-            pList->cur = pList->tail;
-        }
+        s_rcuPending = s_rcuRetired;
+        s_rcuRetired = 0;
+        s_rcuNumRetired = 0;
+        //readers entering from now on can no longer reach the pending nodes
+        s_rcuPendingEpoch = __atomic_add_fetch(&s_rcuEpoch, 1, __ATOMIC_SEQ_CST);
+        //with no reader in the way it is over right away
+        s_rcu_recycle_pending();
     }
-    return List_curr(pList);
 }
 
-// Returns a pointer to the current item in pList.
-void *List_curr(List *pList)
+//s_rcu_poll for callers not holding the rcu lock
+static void s_rcu_reclaim()
 {
-    s_List_assert(pList);
-    //return data if cur is not null
-    if (pList->cur)
+    TS_LOCK(&s_rcuLock);
+    s_rcu_poll();
+    TS_UNLOCK(&s_rcuLock);
+}
+
+//wait until all retired nodes have been recycled
+static void s_rcu_synchronize()
+{
+    while (true)
     {
-        return pList->cur->data;
+        TS_LOCK(&s_rcuLock);
+        s_rcu_poll();
+        bool isWaiting = s_rcuPending != 0;
+        TS_UNLOCK(&s_rcuLock);
+        //once nothing is pending nothing is retired either, see s_rcu_poll
+        if (!isWaiting)
+        {
+            return;
+        }
+        sched_yield();
     }
-    else
+}
+
+//keep a node taken out of a list until no reader can be on it anymore,
+//its listNext stays as is so readers on it can go on
+static void s_rcu_retire(Node *node)
+{
+    TS_LOCK(&s_rcuLock);
+    node->listPrev = s_rcuRetired;
+    s_rcuRetired = s_ref(node);
+    if (++s_rcuNumRetired >= LIST_RCU_BATCH_SIZE)
     {
-        return NULL;
+        s_rcu_poll();
     }
+    TS_UNLOCK(&s_rcuLock);
 }
 
-// Adds the new item to pList directly after the current item, and makes item the current item.
-// If the current pointer is before the start of the pList, the item is added at the start. If
-// the current pointer is beyond the end of the pList, the item is added at the end.
-// Returns 0 on success, -1 on failure.
-int List_add(List *pList, void *pItem)
+//retire a chain of count nodes from first to last linked through listPrev, see s_rcu_retire
+static void s_rcu_retire_chain(Node *first, Node *last, size_t count)
 {
-    s_List_assert(pList);
-    //if no free node, insert fail
-    if (!s_pFreeNode)
+    TS_LOCK(&s_rcuLock);
+    last->listPrev = s_rcuRetired;
+    s_rcuRetired = s_ref(first);
+    s_rcuNumRetired += count;
+    if (s_rcuNumRetired >= LIST_RCU_BATCH_SIZE)
     {
-        return -1;
+        s_rcu_poll();
     }
+    TS_UNLOCK(&s_rcuLock);
+}
 
-    //pop the top of the node stack
-    Node *new = s_pop_free_node();
-    //insert the data
-    new->data = pItem;
+//recycle what readers are done with before giving up on an allocation
+#define RCU_RECLAIM() s_rcu_reclaim()
+//recycle all retired nodes before the pool is switched or reset
+#define RCU_FLUSH() s_rcu_synchronize()
+#else
+#define RCU_RECLAIM()
+#define RCU_FLUSH()
+#endif
 
-    //cur is not null, perform normal double linked list insert
-    if (pList->cur)
+//give a node taken out of a list back to the pool,
+//with LIST_RCU only once no reader can be on it anymore
+static inline void s_release_node(Node *node)
+{
+#ifdef LIST_RCU
+    //the node is unlinked, a thread claiming its first slot after this sees that
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s_rcuNumReaders, __ATOMIC_SEQ_CST))
     {
-        Node *next = pList->cur->listNext;
+        s_rcu_retire(node);
+        return;
+    }
+#endif
+    s_push_free_node(node);
+}
 
-        //1. connect new node with next node
-        new->listNext = next;
+//give a chain of count nodes taken out of a list, from first to last linked through listPrev,
+//back to the pool at once, with LIST_RCU only once no reader can be on them anymore
+static void s_release_chain(Node *first, Node *last, size_t count)
+{
+#ifdef LIST_RCU
+    //the nodes are unlinked, a thread claiming its first slot after this sees that
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s_rcuNumReaders, __ATOMIC_SEQ_CST))
+    {
+        s_rcu_retire_chain(first, last, count);
+        return;
+    }
+#endif
+    s_push_free_chain(first);
+}
 
-        //2. connect cur node with new node
-        pList->cur->listNext = new;
+#ifdef LIST_SNAPSHOT
+//a node handed out is new to every snapshot made so far
+#define SNAPSHOT_STAMP(node) ((node)->stamp = s_pool->epoch)
+#else
+#define SNAPSHOT_STAMP(node)
+#endif
 
-        //3. connect new node with cur node
-        new->listPrev = pList->cur;
+#ifdef LIST_ASYNC_FREE
+//the nodes of a list freed by List_free_async, waiting for the reclaimer
+typedef struct {
+    //first and last node of the chain, which is linked through listNext
+    NodeRef first;
+    NodeRef last;
+    size_t count;
+    size_t itemSize;
+    FREE_FN pItemFreeFn;
+} AsyncJob;
 
-        //if next node is not null
-        if (next)
+//ring of waiting jobs, all of the state below is guarded by s_asyncMutex
+static AsyncJob s_asyncJobs[LIST_ASYNC_MAX_JOBS];
+static size_t s_asyncFirstJob = 0;
+static size_t s_asyncNumJobs = 0;
+//whether the reclaimer thread runs, is told to stop, and is working on a job
+static bool s_asyncStarted = false;
+static bool s_asyncStopping = false;
+static bool s_asyncBusy = false;
+static pthread_t s_asyncThread;
+static pthread_mutex_t s_asyncMutex = PTHREAD_MUTEX_INITIALIZER;
+//signaled when a job is queued or the reclaimer is told to stop
+static pthread_cond_t s_asyncWork = PTHREAD_COND_INITIALIZER;
+//signaled when a job is taken out of the ring or done
+static pthread_cond_t s_asyncDone = PTHREAD_COND_INITIALIZER;
+
+//call the free routine on the items of a job and give its nodes back,
+//a batch of nodes at a time linked through listPrev like List_remove_if does
+static void s_async_reclaim(AsyncJob *job)
+{
+    Node *batch = NULL;
+    Node *batchFirst = NULL;
+    size_t batchCount = 0;
+    Node *node = s_node(job->first);
+    for (size_t i = 0; i < job->count; ++i)
+    {
+        Node *next = s_node(node->listNext);
+        (*job->pItemFreeFn)(job->itemSize ? (void *)node->inlineData : node->data);
+
+        //readers on the node can still follow its listNext until it is released
+        node->listPrev = s_ref(batch);
+        batch = node;
+        if (!batchFirst)
         {
-            //4. connect next node with new node
-            next->listPrev = new;
+            batchFirst = node;
         }
-        //otherwise, cur is the tail
-        else
+        if (++batchCount == LIST_ASYNC_BATCH_SIZE || i + 1 == job->count)
         {
-            //5. make new node the new tail
-            pList->tail = new;
+            s_release_chain(batch, batchFirst, batchCount);
+            batch = NULL;
+            batchFirst = NULL;
+            batchCount = 0;
         }
+        node = next;
     }
-    //if current is NULL, do special insert logic
-    else
+}
+
+//reclaimer thread, takes jobs out of the ring until it is told to stop and the ring is empty
+static void *s_async_reclaimer(void *pArg)
+{
+    pthread_mutex_lock(&s_asyncMutex);
+    while (true)
     {
-        s_special_insert(pList, new);
+        while (!s_asyncNumJobs && !s_asyncStopping)
+        {
+            pthread_cond_wait(&s_asyncWork, &s_asyncMutex);
+        }
+        if (!s_asyncNumJobs)
+        {
+            break;
+        }
+        AsyncJob job = s_asyncJobs[s_asyncFirstJob];
+        s_asyncFirstJob = (s_asyncFirstJob + 1) % LIST_ASYNC_MAX_JOBS;
+        --s_asyncNumJobs;
+        s_asyncBusy = true;
+        //a slot is free again for a caller waiting on a full ring
+        pthread_cond_broadcast(&s_asyncDone);
+        pthread_mutex_unlock(&s_asyncMutex);
+
+        s_async_reclaim(&job);
+
+        pthread_mutex_lock(&s_asyncMutex);
+        s_asyncBusy = false;
+        pthread_cond_broadcast(&s_asyncDone);
     }
-    pList->cur = new;
-    ++(pList->length);
+    pthread_mutex_unlock(&s_asyncMutex);
+    return NULL;
+}
 
-    return 0;
+//hand a job to the reclaimer, starting it if it does not run yet and waiting
+//while the ring is full, returns false if the thread cannot be started, or if the ring
+//is full and the caller is the reclaimer itself, freeing a list owned by an item
+static bool s_async_queue(AsyncJob *job)
+{
+    pthread_mutex_lock(&s_asyncMutex);
+    if (!s_asyncStarted)
+    {
+        if (pthread_create(&s_asyncThread, NULL, s_async_reclaimer, NULL) != 0)
+        {
+            pthread_mutex_unlock(&s_asyncMutex);
+            return false;
+        }
+        s_asyncStarted = true;
+    }
+    else if (s_asyncNumJobs == LIST_ASYNC_MAX_JOBS && pthread_equal(pthread_self(), s_asyncThread))
+    {
+        pthread_mutex_unlock(&s_asyncMutex);
+        return false;
+    }
+    while (s_asyncNumJobs == LIST_ASYNC_MAX_JOBS)
+    {
+        pthread_cond_wait(&s_asyncDone, &s_asyncMutex);
+    }
+    s_asyncJobs[(s_asyncFirstJob + s_asyncNumJobs) % LIST_ASYNC_MAX_JOBS] = *job;
+    ++s_asyncNumJobs;
+    pthread_cond_signal(&s_asyncWork);
+    pthread_mutex_unlock(&s_asyncMutex);
+    return true;
 }
 
-// Adds item to pList directly before the current item, and makes the new item the current one.
-// If the current pointer is before the start of the pList, the item is added at the start.
-// If the current pointer is beyond the end of the pList, the item is added at the end.
-// Returns 0 on success, -1 on failure.
-int List_insert(List *pList, void *pItem)
+//wait until the reclaimer is done with every job queued so far
+static void s_async_flush()
 {
-    s_List_assert(pList);
-    //if no free node, insert fail
-    if (!s_pFreeNode)
+    pthread_mutex_lock(&s_asyncMutex);
+    while (s_asyncNumJobs || s_asyncBusy)
     {
-        return -1;
+        pthread_cond_wait(&s_asyncDone, &s_asyncMutex);
     }
+    pthread_mutex_unlock(&s_asyncMutex);
+}
 
-    //pop the top of the node stack
-    Node *new = s_pop_free_node();
-    //insert the data
-    new->data = pItem;
+//give back all nodes of freed lists before the pool is switched or reset
+#define ASYNC_FLUSH() s_async_flush()
+#else
+#define ASYNC_FLUSH()
+#endif
 
-    //cur is not null, perform normal double linked list insert
-    if (pList->cur)
-    {
-        Node *prev = pList->cur->listPrev;
+//number of free nodes of a partition in the bitmap that are not home nodes,
+//the others have never been used
+static inline size_t s_num_recycled_nodes(NodePartition *part)
+{
+    return part->numFree - (part->end - part->highWater) - part->numFreeHome;
+}
 
-        //1. connect new node with cur node
-        new->listNext = pList->cur;
+//take the next never used node of a partition, with its data set to inital value
+//caller must make sure there is one
+static inline Node *s_take_new_node(NodePartition *part)
+{
+    Node *node = s_pool->nodes + part->highWater++;
+    node->data = NULL;
+    node->listPrev = 0;
+    node->listNext = 0;
+#ifdef LIST_SNAPSHOT
+    node->shadow = 0;
+#endif
+    return node;
+}
 
-        //2. connect cur node with new node
-        pList->cur->listPrev = new;
+//take the lowest free home node of a partition, which only happens once it has no other
+//free node left, caller must make sure there is one
+static Node *s_borrow_home_node(NodePartition *part)
+{
+    //skip the fully used words, 64 nodes at a time
+    while (!s_pool->nodeFreeMap[part->homeHint])
+    {
+        ++part->homeHint;
+    }
+    uint64_t bits = s_pool->nodeFreeMap[part->homeHint];
+    //clear the lowest set bit
+    s_pool->nodeFreeMap[part->homeHint] = bits & (bits - 1);
+    --part->numFreeHome;
+    return s_pool->nodes + part->homeHint * 64 + __builtin_ctzll(bits);
+}
 
-        //3. connect new node with prev node
-        new->listPrev = prev;
+//take the lowest free node out of the bitmap word at mapHint of the home partition,
+//or a never used one if none is recycled, or else a home node,
+//going on to the next partition if it is full
+//caller must have reserved the node
+static Node *s_take_free_node()
+{
+    NodePartition *part = s_home_partition();
+    TS_LOCK(PARTITION_LOCK(part));
+    while (!part->numFree)
+    {
+        TS_UNLOCK(PARTITION_LOCK(part));
+        part = s_next_partition(part);
+        TS_LOCK(PARTITION_LOCK(part));
+    }
 
-        //if prev node is not null
-        if (prev)
-        {
-            //4. connect prev node with new node
-            prev->listNext = new;
-        }
-        //otherwise, cur is the head
-        else
+    Node *node;
+    if (s_num_recycled_nodes(part))
+    {
+        //skip the fully used words, 64 nodes at a time
+        while (!s_pool->nodeFreeMap[part->mapHint])
         {
-            //5. make new node the new head
-            pList->head = new;
+            ++part->mapHint;
         }
+        uint64_t word = s_pool->nodeFreeMap[part->mapHint];
+        //clear the lowest set bit
+        s_pool->nodeFreeMap[part->mapHint] = word & (word - 1);
+        node = s_pool->nodes + part->mapHint * 64 + __builtin_ctzll(word);
+    }
+    else if (part->highWater < part->end)
+    {
+        node = s_take_new_node(part);
     }
-    //if current is NULL, do special insert logic
     else
     {
-        s_special_insert(pList, new);
+        node = s_borrow_home_node(part);
     }
-    pList->cur = new;
-    ++(pList->length);
-
-    return 0;
+    SNAPSHOT_STAMP(node);
+    --part->numFree;
+    TS_UNLOCK(PARTITION_LOCK(part));
+    STAT_NODES(1);
+    return node;
 }
 
-// Adds item to the end of pList, and makes the new item the current one.
-// Returns 0 on success, -1 on failure.
-int List_append(List *pList, void *pItem)
-{
-    s_List_assert(pList);
+static bool s_skip_reclaim();
 
-    //make cur the tail
-    //then reuse the add logic
-    pList->cur = pList->tail;
-    return List_add(pList, pItem);
+//reserve count nodes, after recycling what readers are done with and then
+//dropping the sorted indexes if there are not enough
+static bool s_reserve_or_reclaim(size_t count)
+{
+    if (!s_reserve_nodes(count))
+    {
+        RCU_RECLAIM();
+        if (!s_reserve_nodes(count))
+        {
+            while (s_skip_reclaim())
+            {
+                if (s_reserve_nodes(count))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+    return true;
 }
 
-// Adds item to the front of pList, and makes the new item the current one.
-// Returns 0 on success, -1 on failure.
-int List_prepend(List *pList, void *pItem)
+//reserve a node, see s_reserve_or_reclaim
+static inline bool s_reserve_node()
 {
-    s_List_assert(pList);
-
-    //make cur the head
-    //then reuse the insert logic
-    pList->cur = pList->head;
-    return List_insert(pList, pItem);
+    return s_reserve_or_reclaim(1);
 }
 
-// Return current item and take it out of pList. Make the next item the current one.
-// If the current pointer is before the start of the pList, or beyond the end of the pList,
-// then do not change the pList and return NULL.
-void *List_remove(List *pList)
+#ifdef LIST_SNAPSHOT
+//pop a node out of node bitmap
+static Node *s_pop_free_node()
 {
-    s_List_assert(pList);
+    if (!s_reserve_node())
+    {
+        return NULL;
+    }
+    return s_take_free_node();
+}
+#endif
 
-    // nothing to remove
-    if (!pList->cur)
+#if LIST_SMALL_SIZE
+//take a free home node of the head of pList, the lowest one, or NULL if it has none
+//caller must have reserved the node
+static Node *s_take_home_node(List *pList)
+{
+    size_t first = (size_t)(pList - s_pool->heads) * LIST_SMALL_SIZE;
+    //bits of the home nodes of the head in their bitmap word
+    uint64_t mask = (~(uint64_t)0 >> (64 - LIST_SMALL_SIZE)) << (first % 64);
+    if (first >= SMALL_NODES)
     {
         return NULL;
     }
+    NodePartition *part = s_partition_of(first);
+    uint64_t *pWord = s_pool->nodeFreeMap + first / 64;
+    Node *node = NULL;
+    TS_LOCK(PARTITION_LOCK(part));
+    uint64_t bits = *pWord & mask;
+    if (bits)
+    {
+        *pWord &= ~(bits & -bits);
+        --part->numFree;
+        --part->numFreeHome;
+        node = s_pool->nodes + first / 64 * 64 + __builtin_ctzll(bits);
+    }
+    TS_UNLOCK(PARTITION_LOCK(part));
+    if (node)
+    {
+        SNAPSHOT_STAMP(node);
+        STAT_NODES(1);
+    }
+    return node;
+}
+#endif
 
-    void *data = pList->cur->data;
+//pop a node for an item of pList, one of the home nodes of its head while it has a free one
+static Node *s_pop_list_node(List *pList)
+{
+    if (!s_reserve_node())
+    {
+        return NULL;
+    }
+#if LIST_SMALL_SIZE
+    Node *node = s_take_home_node(pList);
+    if (node)
+    {
+        return node;
+    }
+#endif
+    return s_take_free_node();
+}
 
-    //if there is a next, link it back to the prev
-    if (pList->cur->listNext)
+//link node after *pPrev at the end of a chain starting at *pFirst
+static inline void s_chain_append(Node **pFirst, Node **pPrev, Node *node)
+{
+    node->listPrev = s_ref(*pPrev);
+    if (*pPrev)
     {
-        pList->cur->listNext->listPrev = pList->cur->listPrev;
+        (*pPrev)->listNext = s_ref(node);
     }
-    //if not, cur is the tail, so prev will be the new tail
     else
     {
-        pList->tail = pList->cur->listPrev;
+        *pFirst = node;
     }
+    *pPrev = node;
+}
 
-    //if there is a prev, link it to the next
-    if (pList->cur->listPrev)
+//take count free nodes of a partition, which must have them, onto the end of a chain
+static void s_take_free_chain(NodePartition *part, size_t count, Node **pFirst, Node **pPrev)
+{
+    //recycled nodes go first, never used ones make up the rest
+    size_t fromMap = s_num_recycled_nodes(part);
+    if (fromMap > count)
     {
-        pList->cur->listPrev->listNext = pList->cur->listNext;
+        fromMap = count;
     }
-    //if not, cur is the head, so next will be the new head
-    else
+    size_t fromNew = count - fromMap;
+    if (fromNew > part->end - part->highWater)
     {
-        pList->head = pList->cur->listNext;
+        fromNew = part->end - part->highWater;
     }
+    //home nodes only when nothing else is left
+    size_t fromHome = count - fromMap - fromNew;
+    part->numFree -= count;
 
-    //point cur to next before erasing the data
-    Node *cur = pList->cur;
-    pList->cur = pList->cur->listNext;
+    while (fromMap)
+    {
+        //skip the fully used words, 64 nodes at a time
+        while (!s_pool->nodeFreeMap[part->mapHint])
+        {
+            ++part->mapHint;
+        }
+        uint64_t word = s_pool->nodeFreeMap[part->mapHint];
+        Node *base = s_pool->nodes + part->mapHint * 64;
 
-    s_push_free_node(cur);
-    --pList->length;
+        //take the whole word when all of it is needed
+        uint64_t taken = word;
+        if ((size_t)__builtin_popcountll(word) > fromMap)
+        {
+            //otherwise only take the lowest fromMap bits
+            taken = 0;
+            for (size_t i = 0; i < fromMap; ++i)
+            {
+                taken |= word & -word;
+                word &= word - 1;
+            }
+        }
+        s_pool->nodeFreeMap[part->mapHint] &= ~taken;
+        fromMap -= __builtin_popcountll(taken);
 
-    return data;
+        //link the taken nodes in ascending order
+        while (taken)
+        {
+            Node *node = base + __builtin_ctzll(taken);
+            taken &= taken - 1;
+            SNAPSHOT_STAMP(node);
+            s_chain_append(pFirst, pPrev, node);
+        }
+    }
+    for (; fromNew; --fromNew)
+    {
+        Node *node = s_take_new_node(part);
+        SNAPSHOT_STAMP(node);
+        s_chain_append(pFirst, pPrev, node);
+    }
+    for (; fromHome; --fromHome)
+    {
+        Node *node = s_borrow_home_node(part);
+        SNAPSHOT_STAMP(node);
+        s_chain_append(pFirst, pPrev, node);
+    }
 }
 
-// Adds pList2 to the end of pList1. The current pointer is set to the current pointer of pList1.
-// pList2 no longer exists after the operation; its head is available
-// for future operations.
-void List_concat(List *pList1, List *pList2)
+//pop count nodes out of the node bitmap, already linked into a chain
+//through listPrev and listNext, and return the first one
+//either all of them are popped or none when there are not enough free nodes
+static Node *s_pop_free_chain(size_t count)
 {
-    s_List_assert(pList1);
-    s_List_assert(pList2);
+    if (count == 0)
+    {
+        return NULL;
+    }
+    if (!s_reserve_or_reclaim(count))
+    {
+        return NULL;
+    }
+    STAT_NODES(count);
 
-    //only perform concat if list 2 is not empty
-    if (pList2->head)
+    //fill up from the home partition first, then from the others in turn
+    Node *first = NULL;
+    Node *prev = NULL;
+    NodePartition *part = s_home_partition();
+    while (count)
     {
-        //if list 1 is not empty
-        if (pList1->tail)
+        TS_LOCK(PARTITION_LOCK(part));
+        size_t taken = count < part->numFree ? count : part->numFree;
+        if (taken)
         {
-            //link list 1 tail to list 2 head
-            pList1->tail->listNext = pList2->head;
-            pList1->tail = pList2->tail;
+            s_take_free_chain(part, taken, &first, &prev);
+            count -= taken;
         }
-        //if list 1 is empty
-        //list 1's head and tail should be list 2's head and tail
-        else
+        TS_UNLOCK(PARTITION_LOCK(part));
+        part = s_next_partition(part);
+    }
+    prev->listNext = 0;
+    return first;
+}
+
+#ifdef LIST_SNAPSHOT
+//give all older versions of the nodes back to the pool, once no snapshot reads them anymore,
+//together with the parked nodes they hang off, in O(high-water marks)
+static void s_snapshot_free_versions()
+{
+    for (size_t i = 0; i < s_pool->numPartitions; ++i)
+    {
+        NodePartition *part = s_pool->partitions + i;
+        for (size_t index = part->start; index < part->highWater; ++index)
         {
-            pList1->head = pList2->head;
-            pList1->tail = pList2->tail;
+            Node *node = s_pool->nodes + index;
+            NodeRef shadow = node->shadow;
+            node->shadow = 0;
+            while (shadow)
+            {
+                Node *version = s_node(shadow);
+                shadow = version->shadow;
+                version->shadow = 0;
+                s_push_free_node(version);
+            }
+            if (node->stamp == SNAPSHOT_PARKED)
+            {
+                node->stamp = s_pool->epoch;
+                s_release_node(node);
+            }
         }
     }
-
-    //add up the length
-    pList1->length += pList2->length;
-
-    //directly push list 2 back to the stack for future reuse (no need to remove)
-    s_push_free_head(pList2);
 }
 
-// Delete pList. itemFree is a pointer to a routine that frees an item.
-// It should be invoked (within List_free) as: (*pItemFree)(itemToBeFreedFromNode);
-// pList and all its nodes no longer exists after the operation; its head and s_nodes are
-// available for future operations.
-void List_free(List *pList, FREE_FN pItemFreeFn)
+//no node is left to keep an older version in, so the snapshots cannot stay as they are:
+//empty every one of them and mark it invalid, then give all versions back
+static void s_snapshot_break()
 {
-    s_List_assert(pList);
-    assert(pItemFreeFn != NULL);
-
-    //set the cur to head, so we can loop through
-    pList->cur = pList->head;
-
-    //while list is not empty
-    while (pList->length)
+    for (size_t i = 0; i < s_pool->headHighWater; ++i)
     {
-        //free the data
-        void *data = pList->cur->data;
-        (*pItemFreeFn)(data);
-        //remove the node
-        List_remove(pList);
+        List *head = s_pool->heads + i;
+        if (!head->isFree && head->snapshotEpoch)
+        {
+            head->head = 0;
+            head->tail = 0;
+            head->cur = 0;
+            head->isBeforeHead = true;
+            head->length = 0;
+            head->snapshotEpoch = SNAPSHOT_BROKEN;
+        }
     }
-
-    //recycle the head
-    s_push_free_head(pList);
+    s_pool->snapshotEpoch = 0;
+    s_snapshot_free_versions();
 }
 
-// Return last item and take it out of pList. Make the new last item the current one.
-// Return NULL if pList is initially empty.
-void *List_trim(List *pList)
+//keep the current version of a node a live snapshot may read before it is changed,
+//then stamp it as changed after all snapshots made so far
+static void s_snapshot_touch(Node *node)
 {
-    s_List_assert(pList);
-
-    //make cur the tail
-    pList->cur = pList->tail;
-    //remove cur = remove tail
-    void *pop = List_remove(pList);
-    //make cur the new tail
-    pList->cur = pList->tail;
-    return pop;
+    if (node->stamp <= s_pool->snapshotEpoch)
+    {
+        Node *version = s_pop_free_node();
+        if (version)
+        {
+            *version = *node;
+            node->shadow = s_ref(version);
+        }
+        else
+        {
+            STAT_FAIL(nodeFailures);
+            s_snapshot_break();
+        }
+    }
+    node->stamp = s_pool->epoch;
 }
 
-// Search pList, starting at the current item, until the end is reached or a match is found.
-// In this context, a match is determined by the comparator parameter. This parameter is a
-// pointer to a routine that takes as its first argument an item pointer, and as its second
-// argument pComparisonArg. Comparator returns 0 if the item and comparisonArg don't match,
-// or 1 if they do. Exactly what constitutes a match is up to the implementor of comparator.
-//
-// If a match is found, the current pointer is left at the matched item and the pointer to
-// that item is returned. If no match is found, the current pointer is left beyond the end of
-// the list and a NULL pointer is returned.
-void *List_search(List *pList, COMPARATOR_FN pComparator, void *pComparisonArg)
+//keep a node taken out of a list out of the pool while snapshots read its versions,
+//as a node handed out as a version is overwritten, shadow and all
+//returns true if the node is parked, it is then given back by s_snapshot_free_versions
+static bool s_snapshot_park(Node *node)
 {
-    s_List_assert(pList);
-
-    if(pList->isBeforeHead){
-        List_next(pList);
+    if (!node->shadow)
+    {
+        return false;
     }
+    node->stamp = SNAPSHOT_PARKED;
+    return true;
+}
 
-    //while cur is not NULL
-    while (pList->cur)
+//every node of pList is about to change, as when it is relinked by List_sort
+static void s_snapshot_touch_list(List *pList)
+{
+    //stamps only matter while there is a snapshot
+    if (s_pool->snapshotEpoch)
     {
-        //compare data in cur with compartor and arg
-        //if equal then return
-        if (pComparator(pList->cur->data, pComparisonArg))
+        for (NodeRef ref = pList->head; ref; ref = s_node(ref)->listNext)
         {
-            return pList->cur->data;
+            s_snapshot_touch(s_node(ref));
         }
-        //not equal, make cur the next
-        List_next(pList);
+    }
+}
+
+//writers must not change a snapshot
+#define SNAPSHOT_WRITE_ASSERT(pList) assert(!(pList)->snapshotEpoch)
+//a node is about to change
+#define SNAPSHOT_TOUCH(node) s_snapshot_touch(node)
+#define SNAPSHOT_TOUCH_LIST(pList) s_snapshot_touch_list(pList)
+//a node taken out of a list is to be released
+#define SNAPSHOT_PARK(node) s_snapshot_park(node)
+#else
+#define SNAPSHOT_WRITE_ASSERT(pList)
+#define SNAPSHOT_TOUCH(node)
+#define SNAPSHOT_TOUCH_LIST(pList)
+#define SNAPSHOT_PARK(node) false
+#endif
+
+//node a list reads for ref: the version a snapshot was made with,
+//or the node itself for a list that is not a snapshot
+static inline Node *s_view(List *pList, NodeRef ref)
+{
+    Node *node = s_node(ref);
+#ifdef LIST_SNAPSHOT
+    if (pList->snapshotEpoch)
+    {
+        while (node && node->stamp > pList->snapshotEpoch)
+        {
+            //a node changed after the snapshot always has the version it had then
+            assert(node->shadow);
+            node = s_node(node->shadow);
+        }
+    }
+#endif
+    return node;
+}
+
+//The sorted index is a skip list made of pool nodes on top of the list.
+//Each level is a lane of index nodes, where skipTarget is the list node it stands for,
+//listNext is the next index node in the lane, and listPrev is the node it stands on,
+//which is the index node one level down or, on the first level, the list node itself.
+//A tower of header nodes starts the lanes: pList->skipIndex is the top header,
+//its listNext is the first index node of the top lane and its listPrev is the
+//header one level down, or 0 on the first level.
+
+//Index nodes only ever take spare nodes: a list that runs out of nodes drops
+//the indexes of all lists, see s_skip_reclaim, and List_free_node_count counts them as free.
+//With LIST_THREAD_SAFE the index of a list is guarded by SKIP_LOCK, which is never held
+//while nodes are reclaimed, only while index nodes are taken or given back.
+
+//list whose sorted index the current thread is walking, which s_skip_reclaim leaves alone
+static __thread List *s_pSkipBusy = NULL;
+
+//give all nodes of the sorted index of pList back to the pool
+//with LIST_THREAD_SAFE the caller must hold SKIP_LOCK(pList)
+static void s_skip_drop(List *pList)
+{
+    size_t count = 0;
+    Node *header = s_node(pList->skipIndex);
+    while (header)
+    {
+        Node *down = s_node(header->listPrev);
+        Node *node = s_node(header->listNext);
+        while (node)
+        {
+            Node *next = s_node(node->listNext);
+            s_push_free_node(node);
+            ++count;
+            node = next;
+        }
+        s_push_free_node(header);
+        ++count;
+        header = down;
+    }
+    __atomic_store_n(&pList->skipIndex, 0, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&s_pool->numSkipNodes, count, __ATOMIC_RELAXED);
+}
+
+//pList is about to change in a way the sorted index does not follow
+static inline void s_skip_invalidate(List *pList)
+{
+    if (pList->skipIndex)
+    {
+        TS_LOCK(SKIP_LOCK(pList));
+        if (pList->skipIndex)
+        {
+            s_skip_drop(pList);
+        }
+        TS_UNLOCK(SKIP_LOCK(pList));
+    }
+}
+
+//drop the sorted index of some list other than the one the current thread is walking,
+//return false if there is none left
+static bool s_skip_reclaim()
+{
+    if (!__atomic_load_n(&s_pool->numSkipNodes, __ATOMIC_RELAXED))
+    {
+        return false;
+    }
+    uint32_t highWater = __atomic_load_n(&s_pool->headHighWater, __ATOMIC_RELAXED);
+    for (List *pList = s_pool->heads; pList < s_pool->heads + highWater; ++pList)
+    {
+        if (pList == s_pSkipBusy || !__atomic_load_n(&pList->skipIndex, __ATOMIC_RELAXED))
+        {
+            continue;
+        }
+        TS_LOCK(SKIP_LOCK(pList));
+        bool isDropped = pList->skipIndex != 0;
+        if (isDropped)
+        {
+            s_skip_drop(pList);
+        }
+        TS_UNLOCK(SKIP_LOCK(pList));
+        if (isDropped)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//pop a node for the sorted index, keeping the reserve for the lists themselves,
+//never reclaiming any, as the caller holds the lock of an index
+static Node *s_skip_pop_node()
+{
+    if (s_num_free_nodes() <= SKIP_RESERVE_NODES || !s_reserve_nodes(1))
+    {
+        return NULL;
+    }
+    __atomic_add_fetch(&s_pool->numSkipNodes, 1, __ATOMIC_RELAXED);
+    return s_take_free_node();
+}
+
+//when adding or inserting to a list with null cur,
+//do a special insert logic
+static void s_special_insert(List *pList, Node *new)
+{
+    //calling this function when cur is not null is not allowed
+    assert(pList->cur == 0);
+    NodeRef newRef = s_ref(new);
+
+    //if before head, add the item to start
+    if (pList->isBeforeHead)
+    {
+        new->listNext = pList->head;
+        new->listPrev = 0;
+
+        //if there was a head, head should point back to the added item
+        if (pList->head)
+        {
+            SNAPSHOT_TOUCH(s_node(pList->head));
+            s_node(pList->head)->listPrev = newRef;
+        }
+        //there was no head, the list was empty
+        //the new item should also be the tail
+        else
+        {
+            pList->tail = newRef;
+        }
+
+        //let the item be the new head
+        LINK_PUBLISH(pList->head, newRef);
+    }
+    //current is NULL and not before head, means it should be after tail
+    //add it to the tail
+    else
+    {
+        new->listPrev = pList->tail;
+        new->listNext = 0;
+
+        //if there was a tail, tail should point to the added item
+        if (pList->tail)
+        {
+            SNAPSHOT_TOUCH(s_node(pList->tail));
+            LINK_PUBLISH(s_node(pList->tail)->listNext, newRef);
+        }
+        //there was no tail, the list was empty
+        //the new item should also be the head
+        else
+        {
+            LINK_PUBLISH(pList->head, newRef);
+        }
+
+        //let the item be the new tail
+        pList->tail = newRef;
+    }
+}
+
+//return the item at cur, or NULL if cur is before head or beyond end
+static void *s_curr(List *pList)
+{
+    //return data if cur is not null
+    if (pList->cur)
+    {
+        return s_item(pList, s_view(pList, pList->cur));
+    }
+    else
+    {
+        return NULL;
+    }
+}
+
+//add an item after cur, see List_add
+static int s_add(List *pList, void *pItem)
+{
+    s_skip_invalidate(pList);
+
+    //pop a node out of the pool
+    Node *new = s_pop_list_node(pList);
+    //if no free node, insert fail
+    if (!new)
+    {
+        STAT_FAIL(nodeFailures);
+        return -1;
+    }
+    //insert the data
+    s_set_item(pList, new, pItem);
+    NodeRef newRef = s_ref(new);
+
+    //cur is not null, perform normal double linked list insert
+    if (pList->cur)
+    {
+        Node *cur = s_node(pList->cur);
+        NodeRef next = cur->listNext;
+        SNAPSHOT_TOUCH(cur);
+
+        //1. connect new node with next node
+        new->listNext = next;
+
+        //2. connect cur node with new node
+        LINK_PUBLISH(cur->listNext, newRef);
+
+        //3. connect new node with cur node
+        new->listPrev = pList->cur;
+
+        //if next node is not null
+        if (next)
+        {
+            //4. connect next node with new node
+            SNAPSHOT_TOUCH(s_node(next));
+            s_node(next)->listPrev = newRef;
+        }
+        //otherwise, cur is the tail
+        else
+        {
+            //5. make new node the new tail
+            pList->tail = newRef;
+        }
+    }
+    //if current is NULL, do special insert logic
+    else
+    {
+        s_special_insert(pList, new);
+    }
+    pList->cur = newRef;
+    ++(pList->length);
+
+    return 0;
+}
+
+//insert an item before cur, see List_insert
+static int s_insert(List *pList, void *pItem)
+{
+    s_skip_invalidate(pList);
+
+    //pop a node out of the pool
+    Node *new = s_pop_list_node(pList);
+    //if no free node, insert fail
+    if (!new)
+    {
+        STAT_FAIL(nodeFailures);
+        return -1;
+    }
+    //insert the data
+    s_set_item(pList, new, pItem);
+    NodeRef newRef = s_ref(new);
+
+    //cur is not null, perform normal double linked list insert
+    if (pList->cur)
+    {
+        Node *cur = s_node(pList->cur);
+        NodeRef prev = cur->listPrev;
+        SNAPSHOT_TOUCH(cur);
+
+        //1. connect new node with cur node
+        new->listNext = pList->cur;
+
+        //2. connect cur node with new node
+        cur->listPrev = newRef;
+
+        //3. connect new node with prev node
+        new->listPrev = prev;
+
+        //if prev node is not null
+        if (prev)
+        {
+            //4. connect prev node with new node
+            SNAPSHOT_TOUCH(s_node(prev));
+            LINK_PUBLISH(s_node(prev)->listNext, newRef);
+        }
+        //otherwise, cur is the head
+        else
+        {
+            //5. make new node the new head
+            LINK_PUBLISH(pList->head, newRef);
+        }
+    }
+    //if current is NULL, do special insert logic
+    else
+    {
+        s_special_insert(pList, new);
+    }
+    pList->cur = newRef;
+    ++(pList->length);
+
+    return 0;
+}
+
+//item of a node about to be taken out of the list and recycled,
+//for inline lists a copy kept in the head
+static inline void *s_removed_item(List *pList, Node *node)
+{
+    if (pList->itemSize)
+    {
+        memcpy(pList->removedItem, node->inlineData, pList->itemSize);
+        return pList->removedItem;
+    }
+    return node->data;
+}
+
+//take cur out of the list, see List_remove
+static void *s_remove(List *pList)
+{
+    // nothing to remove
+    if (!pList->cur)
+    {
+        return NULL;
+    }
+
+    s_skip_invalidate(pList);
+    Node *cur = s_node(pList->cur);
+    void *data = s_removed_item(pList, cur);
+
+    //if there is a next, link it back to the prev
+    if (cur->listNext)
+    {
+        SNAPSHOT_TOUCH(s_node(cur->listNext));
+        s_node(cur->listNext)->listPrev = cur->listPrev;
+    }
+    //if not, cur is the tail, so prev will be the new tail
+    else
+    {
+        pList->tail = cur->listPrev;
+    }
+
+    //if there is a prev, link it to the next
+    if (cur->listPrev)
+    {
+        SNAPSHOT_TOUCH(s_node(cur->listPrev));
+        LINK_PUBLISH(s_node(cur->listPrev)->listNext, cur->listNext);
+    }
+    //if not, cur is the head, so next will be the new head
+    else
+    {
+        LINK_PUBLISH(pList->head, cur->listNext);
+    }
+
+    //point cur to next before erasing the data
+    pList->cur = cur->listNext;
+
+    SNAPSHOT_TOUCH(cur);
+    if (!SNAPSHOT_PARK(cur))
+    {
+        s_release_node(cur);
+    }
+    --pList->length;
+
+    return data;
+}
+
+//advance cur by one, see List_next
+static void *s_next(List *pList)
+{
+    //if cur is not empty, return next
+    if (pList->cur)
+    {
+        pList->cur = s_view(pList, pList->cur)->listNext;
+        pList->isBeforeHead = false;
+    }
+    //if current is empty, need to know if current is beyond head or after tail
+    else
+    {
+        //if beyond head, next should be point to head
+        if (pList->isBeforeHead)
+        {
+            pList->cur = pList->head;
+            pList->isBeforeHead = false;
+        }
+        //current is empty and not beyond head, means it should be after tail
+        else
+        {
+            return NULL;
+        }
+    }
+    return s_curr(pList);
+}
+
+//merge two sorted chains linked through listNext only, and return the merged chain
+//items of first go before equal items of second to keep the merge stable
+static Node *s_merge_chains(List *pList, Node *first, Node *second, ORDER_FN pOrder)
+{
+    NodeRef merged = 0;
+    NodeRef *pLink = &merged;
+    while (first && second)
+    {
+        //only take from second when it is strictly smaller
+        Node *taken;
+        if ((*pOrder)(s_item(pList, second), s_item(pList, first)) < 0)
+        {
+            taken = second;
+            second = s_node(second->listNext);
+        }
+        else
+        {
+            taken = first;
+            first = s_node(first->listNext);
+        }
+        *pLink = s_ref(taken);
+        pLink = &taken->listNext;
+    }
+    //append whatever is left over
+    *pLink = s_ref(first ? first : second);
+    return s_node(merged);
+}
+
+//rebuild listPrev and tail of pList after its chain was relinked through listNext only
+static void s_relink_prev(List *pList)
+{
+    NodeRef prev = 0;
+    for (NodeRef ref = pList->head; ref; ref = s_node(ref)->listNext)
+    {
+        s_node(ref)->listPrev = prev;
+        prev = ref;
+    }
+    pList->tail = prev;
+}
+
+//take a head out of the pool, see List_create
+static List *s_create()
+{
+    TS_LOCK(&s_headPoolLock);
+    //O(1) set-up at the very first time, heads and nodes are set up as they are used
+    if (!s_pool->hasInit)
+    {
+        s_init();
+    }
+
+    //return the top of the head stack
+    List *pList = s_pop_free_head();
+    TS_UNLOCK(&s_headPoolLock);
+    if (!pList)
+    {
+        STAT_FAIL(headFailures);
+    }
+    return pList;
+}
+
+//centralized assert
+static void s_List_assert(List *pList){
+    //the given pointer must not be NULL or in the pool
+    //and must be a head of the pool in use, not of a detached one
+    assert(pList != NULL && !pList->isFree);
+    assert(pList >= s_pool->heads && pList < s_pool->heads + LIST_MAX_NUM_HEADS);
+}
+
+//centralized assert for refs handed to the List_*_ref functions and List_clone_range
+static void s_ref_assert(NodeRef ref)
+{
+    assert(ref > 0 && ref <= LIST_MAX_NUM_NODES);
+}
+
+// Makes a new, empty list, and returns its reference on success.
+// Returns a NULL pointer on failure.
+List *List_create()
+{
+    LIST_ENTER(LIST_OP_CREATE);
+    List *pList = s_create();
+    RECORD(LIST_OP_CREATE, pList, 0, NULL);
+    return pList;
+}
+
+// Makes a new, empty list whose items are itemSize byte values stored inside the
+// nodes instead of pointers to items stored elsewhere. itemSize must be between 1 and
+// LIST_INLINE_MAX_SIZE, and items must not need more alignment than a pointer.
+// Returns its reference on success, or a NULL pointer on failure.
+List *List_create_inline(size_t itemSize)
+{
+    LIST_ENTER(LIST_OP_CREATE_INLINE);
+
+    //the item has to fit in the node
+    if (itemSize == 0 || itemSize > LIST_INLINE_MAX_SIZE)
+    {
+        return NULL;
+    }
+
+    List *pList = s_create();
+    if (pList)
+    {
+        pList->itemSize = itemSize;
+    }
+    RECORD(LIST_OP_CREATE_INLINE, pList, itemSize, NULL);
+    return pList;
+}
+
+// Returns the number of items in pList.
+int List_count(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_COUNT);
+    RECORD(LIST_OP_COUNT, pList, 0, NULL);
+    return pList->length;
+}
+
+// Returns the number of nodes still available in the shared node pool, including the ones
+// the indexes of List_insert_sorted hold, as they are given back whenever a list needs them.
+int List_free_node_count()
+{
+    LIST_ENTER(LIST_OP_FREE_NODE_COUNT);
+    //the pool is full before the first List_create
+    if (!s_pool->hasInit)
+    {
+        return LIST_MAX_NUM_NODES;
+    }
+    return s_num_free_nodes() + __atomic_load_n(&s_pool->numSkipNodes, __ATOMIC_RELAXED);
+}
+
+// Returns a pointer to the first item in pList and makes the first item the current item.
+// Returns NULL and sets current item to NULL if list is empty.
+void *List_first(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_FIRST);
+    RECORD(LIST_OP_FIRST, pList, 0, NULL);
+    //head is not null, then return head
+    if (pList->head)
+    {
+        pList->cur = pList->head;
+        return s_item(pList, s_view(pList, pList->cur));
+    }
+    //head is null means list is empty
+    //then cur should be before head
+    else
+    {
+        pList->cur = 0;
+        pList->isBeforeHead = true;
+        return NULL;
+    }
+}
+
+// Returns a pointer to the last item in pList and makes the last item the current item.
+// Returns NULL and sets current item to NULL if list is empty.
+void *List_last(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_LAST);
+    RECORD(LIST_OP_LAST, pList, 0, NULL);
+
+    //no matter what, cur should no longer before head
+    pList->isBeforeHead = false;
+    //tail is not null return tail
+    if (pList->tail)
+    {
+        pList->cur = pList->tail;
+        return s_item(pList, s_view(pList, pList->cur));
+    }
+    //else list is empty,
+    else
+    {
+        pList->cur = 0;
+        return NULL;
+    }
+}
+
+// Advances pList's current item by one, and returns a pointer to the new current item.
+// If this operation advances the current item beyond the end of the pList, a NULL pointer
+// is returned and the current item is set to be beyond end of pList.
+void *List_next(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_NEXT);
+    RECORD(LIST_OP_NEXT, pList, 0, NULL);
+    return s_next(pList);
+}
+
+// Backs up pList's current item by one, and returns a pointer to the new current item.
+// If this operation backs up the current item beyond the start of the pList, a NULL pointer
+// is returned and the current item is set to be before the start of pList.
+void *List_prev(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_PREV);
+    RECORD(LIST_OP_PREV, pList, 0, NULL);
+    //if cur is not empty, return prev
+    if (pList->cur)
+    {
+        //if cur is head, the calling prev will point cur to before head
+        if (pList->cur == pList->head)
+        {
+            pList->isBeforeHead = true;
+        }
+        pList->cur = s_view(pList, pList->cur)->listPrev;
+    }
+    //if current is NULL, need to know if current is beyond head or after tail
+    else
+    {
+        //if beyond head, do nothing
+        if (pList->isBeforeHead)
+        {
+            return NULL;
+        }
+        //current is NULL and not beyond head, means it should be after tail
+        //so prev should be tail
+        else
+        {
+            pList->cur = pList->tail;
+        }
+    }
+    return s_curr(pList);
+}
+
+// Returns a pointer to the current item in pList.
+void *List_curr(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_CURR);
+    RECORD(LIST_OP_CURR, pList, 0, NULL);
+    return s_curr(pList);
+}
+
+// Adds the new item to pList directly after the current item, and makes item the current item.
+// If the current pointer is before the start of the pList, the item is added at the start. If
+// the current pointer is beyond the end of the pList, the item is added at the end.
+// Returns 0 on success, -1 on failure.
+int List_add(List *pList, void *pItem)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_ADD);
+    RECORD(LIST_OP_ADD, pList, 0, pItem);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    return s_add(pList, pItem);
+}
+
+// Adds item to pList directly before the current item, and makes the new item the current one.
+// If the current pointer is before the start of the pList, the item is added at the start.
+// If the current pointer is beyond the end of the pList, the item is added at the end.
+// Returns 0 on success, -1 on failure.
+int List_insert(List *pList, void *pItem)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_INSERT);
+    RECORD(LIST_OP_INSERT, pList, 0, pItem);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    return s_insert(pList, pItem);
+}
+
+// Adds item to the end of pList, and makes the new item the current one.
+// Returns 0 on success, -1 on failure.
+int List_append(List *pList, void *pItem)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_APPEND);
+    RECORD(LIST_OP_APPEND, pList, 0, pItem);
+    SNAPSHOT_WRITE_ASSERT(pList);
+
+    //make cur the tail
+    //then reuse the add logic
+    pList->cur = pList->tail;
+    return s_add(pList, pItem);
+}
+
+// Adds item to the front of pList, and makes the new item the current one.
+// Returns 0 on success, -1 on failure.
+int List_prepend(List *pList, void *pItem)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_PREPEND);
+    RECORD(LIST_OP_PREPEND, pList, 0, pItem);
+    SNAPSHOT_WRITE_ASSERT(pList);
+
+    //make cur the head
+    //then reuse the insert logic
+    pList->cur = pList->head;
+    return s_insert(pList, pItem);
+}
+
+// Adds count items from pItems to the end of pList, in order, and makes the last added
+// item the current one. The nodes are reserved from the pool in one step, so either all
+// items are added or, if the pool cannot hold them, none are and pList is unchanged.
+// Returns 0 on success, -1 on failure.
+int List_append_all(List *pList, void **pItems, int count)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_APPEND_ALL);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    assert(count >= 0);
+    RECORD_ITEMS(pList, pItems, count);
+    RECORD(LIST_OP_APPEND_ALL, pList, count, NULL);
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    s_skip_invalidate(pList);
+
+    //reserve all the nodes up front, fail without touching the list
+    Node *first = s_pop_free_chain(count);
+    if (!first)
+    {
+        STAT_FAIL(nodeFailures);
+        return -1;
+    }
+
+    //fill in the items, the chain is already linked
+    Node *last = first;
+    for (int i = 0; i < count; ++i)
+    {
+        s_set_item(pList, last, pItems[i]);
+        if (last->listNext)
+        {
+            last = s_node(last->listNext);
+        }
+    }
+
+    //hang the chain after the old tail
+    first->listPrev = pList->tail;
+    if (pList->tail)
+    {
+        SNAPSHOT_TOUCH(s_node(pList->tail));
+        LINK_PUBLISH(s_node(pList->tail)->listNext, s_ref(first));
+    }
+    else
+    {
+        LINK_PUBLISH(pList->head, s_ref(first));
+    }
+
+    pList->tail = s_ref(last);
+    pList->cur = pList->tail;
+    pList->isBeforeHead = false;
+    pList->length += count;
+
+    return 0;
+}
+
+//copy count items of pList, from the node first on, into a new list with the same cur
+//or before head if cur is not among them, see List_clone
+static List *s_clone(List *pList, NodeRef first, size_t count)
+{
+    List *pClone = s_create();
+    if (!pClone)
+    {
+        return NULL;
+    }
+    pClone->itemSize = pList->itemSize;
+    if (count == 0)
+    {
+        return pClone;
+    }
+
+    //reserve all the nodes up front, they come linked and in ascending order as far as
+    //the pool allows, fail without keeping any of them
+    Node *chain = s_pop_free_chain(count);
+    if (!chain)
+    {
+        STAT_FAIL(nodeFailures);
+        s_push_free_head(pClone);
+        return NULL;
+    }
+
+    //fill in the items in one pass over both chains
+    Node *copy = chain;
+    Node *last = NULL;
+    for (NodeRef ref = first; copy; ref = s_view(pList, ref)->listNext)
+    {
+        s_set_item(pClone, copy, s_item(pList, s_view(pList, ref)));
+        if (ref == pList->cur)
+        {
+            pClone->cur = s_ref(copy);
+            pClone->isBeforeHead = false;
+        }
+        last = copy;
+        copy = s_node(copy->listNext);
+    }
+
+    pClone->head = s_ref(chain);
+    pClone->tail = s_ref(last);
+    pClone->length = count;
+    return pClone;
+}
+
+// Makes a new list holding a copy of every item of pList in the same order, whose current
+// item is the copy of the current item of pList. All nodes are taken from the pool in one
+// step and linked in one pass, so on failure nothing is taken. Items of lists not made by
+// List_create_inline are pointers, which are copied as they are.
+// Returns the new list on success, or a NULL pointer if there is no head or not enough
+// nodes left.
+List *List_clone(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_CLONE);
+    List *pClone = s_clone(pList, pList->head, pList->length);
+    //before head and beyond end carry over too
+    if (pClone && !pList->cur)
+    {
+        pClone->isBeforeHead = pList->isBeforeHead;
+    }
+    RECORD(LIST_OP_CLONE, pList, RECORD_ID(pClone), NULL);
+    return pClone;
+}
+
+// Like List_clone, for the items of pList from the node first to the node last, both refs of
+// pList with last not before first. The current item of the new list is the copy of the
+// current item of pList if it is in the range, otherwise it is before the start.
+List *List_clone_range(List *pList, NodeRef first, NodeRef last)
+{
+    s_List_assert(pList);
+    s_ref_assert(first);
+    s_ref_assert(last);
+    LIST_ENTER(LIST_OP_CLONE_RANGE);
+
+    //count the range first, so all its nodes can be reserved at once
+    size_t count = 1;
+    for (NodeRef ref = first; ref != last; ++count)
+    {
+        ref = s_view(pList, ref)->listNext;
+        //last must come after first
+        assert(ref);
+    }
+    return s_clone(pList, first, count);
+}
+
+// Return current item and take it out of pList. Make the next item the current one.
+// If the current pointer is before the start of the pList, or beyond the end of the pList,
+// then do not change the pList and return NULL.
+void *List_remove(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_REMOVE);
+    RECORD(LIST_OP_REMOVE, pList, 0, NULL);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    return s_remove(pList);
+}
+
+// Adds pList2 to the end of pList1. The current pointer is set to the current pointer of pList1.
+// pList2 no longer exists after the operation; its head is available
+// for future operations.
+void List_concat(List *pList1, List *pList2)
+{
+    s_List_assert(pList1);
+    s_List_assert(pList2);
+    LIST_ENTER(LIST_OP_CONCAT);
+    RECORD(LIST_OP_CONCAT, pList1, RECORD_ID(pList2), NULL);
+    SNAPSHOT_WRITE_ASSERT(pList1);
+    SNAPSHOT_WRITE_ASSERT(pList2);
+    assert(pList1->itemSize == pList2->itemSize);
+    s_skip_invalidate(pList1);
+    s_skip_invalidate(pList2);
+
+    //only perform concat if list 2 is not empty
+    if (pList2->head)
+    {
+        //if list 1 is not empty
+        if (pList1->tail)
+        {
+            //link list 1 tail and list 2 head both ways
+            SNAPSHOT_TOUCH(s_node(pList1->tail));
+            SNAPSHOT_TOUCH(s_node(pList2->head));
+            LINK_PUBLISH(s_node(pList1->tail)->listNext, pList2->head);
+            s_node(pList2->head)->listPrev = pList1->tail;
+            pList1->tail = pList2->tail;
+        }
+        //if list 1 is empty
+        //list 1's head and tail should be list 2's head and tail
+        else
+        {
+            LINK_PUBLISH(pList1->head, pList2->head);
+            pList1->tail = pList2->tail;
+        }
+    }
+
+    //add up the length
+    pList1->length += pList2->length;
+
+    //directly push list 2 back to the stack for future reuse (no need to remove)
+    s_push_free_head(pList2);
+}
+
+// Delete pList. itemFree is a pointer to a routine that frees an item.
+// It should be invoked (within List_free) as: (*pItemFree)(itemToBeFreedFromNode);
+// pList and all its nodes no longer exists after the operation; its head and nodes are
+// available for future operations.
+void List_free(List *pList, FREE_FN pItemFreeFn)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_FREE);
+    RECORD(LIST_OP_FREE, pList, 0, NULL);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    assert(pItemFreeFn != NULL);
+    s_skip_invalidate(pList);
+
+    //set the cur to head, so we can loop through
+    pList->cur = pList->head;
+
+    //while list is not empty
+    while (pList->length)
+    {
+        //free the data
+        (*pItemFreeFn)(s_item(pList, s_node(pList->cur)));
+        //remove the node
+        s_remove(pList);
+    }
+
+    //recycle the head
+    s_push_free_head(pList);
+}
+
+// Return last item and take it out of pList. Make the new last item the current one.
+// Return NULL if pList is initially empty.
+void *List_trim(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_TRIM);
+    RECORD(LIST_OP_TRIM, pList, 0, NULL);
+    SNAPSHOT_WRITE_ASSERT(pList);
+
+    //make cur the tail
+    pList->cur = pList->tail;
+    //remove cur = remove tail
+    void *pop = s_remove(pList);
+    //make cur the new tail
+    pList->cur = pList->tail;
+    return pop;
+}
+
+// Add pItem to the back of pList, leaving the current item where it is.
+// Return 0 on success, -1 on failure.
+int List_push_back(List *pList, void *pItem)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_PUSH_BACK);
+    RECORD(LIST_OP_PUSH_BACK, pList, 0, pItem);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    s_skip_invalidate(pList);
+
+    Node *new = s_pop_list_node(pList);
+    if (!new)
+    {
+        STAT_FAIL(nodeFailures);
+        return -1;
+    }
+    s_set_item(pList, new, pItem);
+    NodeRef newRef = s_ref(new);
+    new->listPrev = pList->tail;
+    new->listNext = 0;
+
+    //the link to the new node is the one of the old tail, or the head of an empty list
+    if (pList->tail)
+    {
+        SNAPSHOT_TOUCH(s_node(pList->tail));
+    }
+    NodeRef *pLink = pList->tail ? &s_node(pList->tail)->listNext : &pList->head;
+    LINK_PUBLISH(*pLink, newRef);
+    pList->tail = newRef;
+    ++pList->length;
+    return 0;
+}
+
+// Add pItem to the front of pList, leaving the current item where it is.
+// Return 0 on success, -1 on failure.
+int List_push_front(List *pList, void *pItem)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_PUSH_FRONT);
+    RECORD(LIST_OP_PUSH_FRONT, pList, 0, pItem);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    s_skip_invalidate(pList);
+
+    Node *new = s_pop_list_node(pList);
+    if (!new)
+    {
+        STAT_FAIL(nodeFailures);
+        return -1;
+    }
+    s_set_item(pList, new, pItem);
+    NodeRef newRef = s_ref(new);
+    new->listPrev = 0;
+    new->listNext = pList->head;
+
+    //the link back to the new node is the one of the old head, or the tail of an empty list
+    if (pList->head)
+    {
+        SNAPSHOT_TOUCH(s_node(pList->head));
+    }
+    NodeRef *pLink = pList->head ? &s_node(pList->head)->listPrev : &pList->tail;
+    *pLink = newRef;
+    LINK_PUBLISH(pList->head, newRef);
+    ++pList->length;
+    return 0;
+}
+
+// Return the last item and take it out of pList, leaving the current item where it is
+// unless it is the last item, which makes the new last item the current one.
+// Return NULL if pList is empty.
+void *List_pop_back(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_POP_BACK);
+    RECORD(LIST_OP_POP_BACK, pList, 0, NULL);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    if (!pList->tail)
+    {
+        return NULL;
+    }
+    s_skip_invalidate(pList);
+
+    NodeRef ref = pList->tail;
+    Node *last = s_node(ref);
+    void *data = s_removed_item(pList, last);
+    NodeRef prev = last->listPrev;
+
+    //the link to the last node is the one of the node before it, or the head of a list of one
+    if (prev)
+    {
+        SNAPSHOT_TOUCH(s_node(prev));
+    }
+    NodeRef *pLink = prev ? &s_node(prev)->listNext : &pList->head;
+    LINK_PUBLISH(*pLink, 0);
+    pList->tail = prev;
+    if (pList->cur == ref)
+    {
+        pList->cur = prev;
+    }
+
+    SNAPSHOT_TOUCH(last);
+    if (!SNAPSHOT_PARK(last))
+    {
+        s_release_node(last);
+    }
+    --pList->length;
+    return data;
+}
+
+// Return the first item and take it out of pList, leaving the current item where it is
+// unless it is the first item, which makes the new first item the current one.
+// Return NULL if pList is empty.
+void *List_pop_front(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_POP_FRONT);
+    RECORD(LIST_OP_POP_FRONT, pList, 0, NULL);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    if (!pList->head)
+    {
+        return NULL;
+    }
+    s_skip_invalidate(pList);
+
+    NodeRef ref = pList->head;
+    Node *first = s_node(ref);
+    void *data = s_removed_item(pList, first);
+    NodeRef next = first->listNext;
+
+    //the link back to the first node is the one of the node after it, or the tail of a list of one
+    if (next)
+    {
+        SNAPSHOT_TOUCH(s_node(next));
+    }
+    NodeRef *pLink = next ? &s_node(next)->listPrev : &pList->tail;
+    *pLink = 0;
+    LINK_PUBLISH(pList->head, next);
+    if (pList->cur == ref)
+    {
+        pList->cur = next;
+    }
+
+    //readers on the node can still follow its listNext
+    SNAPSHOT_TOUCH(first);
+    if (!SNAPSHOT_PARK(first))
+    {
+        s_release_node(first);
+    }
+    --pList->length;
+    return data;
+}
+
+// Search pList, starting at the current item, until the end is reached or a match is found.
+// In this context, a match is determined by the comparator parameter. This parameter is a
+// pointer to a routine that takes as its first argument an item pointer, and as its second
+// argument pComparisonArg. Comparator returns 0 if the item and comparisonArg don't match,
+// or 1 if they do. Exactly what constitutes a match is up to the implementor of comparator.
+//
+// If a match is found, the current pointer is left at the matched item and the pointer to
+// that item is returned. If no match is found, the current pointer is left beyond the end of
+// the list and a NULL pointer is returned.
+void *List_search(List *pList, COMPARATOR_FN pComparator, void *pComparisonArg)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_SEARCH);
+
+    //only a NULL cur can be before head, List_first and adds
+    //leave isBeforeHead as is once cur points to a node
+    if(!pList->cur && pList->isBeforeHead){
+        s_next(pList);
+    }
+
+    //while cur is not NULL
+    while (pList->cur)
+    {
+        //compare data in cur with compartor and arg
+        //if equal then return
+        void *pItem = s_item(pList, s_view(pList, pList->cur));
+        if (pComparator(pItem, pComparisonArg))
+        {
+            RECORD(LIST_OP_SEARCH, pList, 0, pItem);
+            return pItem;
+        }
+        //not equal, make cur the next
+        s_next(pList);
     }
     // not found
+    RECORD(LIST_OP_SEARCH, pList, 0, NULL);
+    return NULL;
+}
+
+// Takes every item of pList that pComparator matches with pComparisonArg out of pList, in
+// one pass from the first item, calling pItemFreeFn on each of them unless it is NULL.
+// Returns the number of items taken out.
+//
+// If the current item is taken out, the next item that stays becomes the current one, or
+// the current pointer is left beyond the end of the list if there is none. Otherwise the
+// current item, and before the start and beyond the end, stay as is.
+int List_remove_if(List *pList, COMPARATOR_FN pComparator, void *pComparisonArg, FREE_FN pItemFreeFn)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_REMOVE_IF);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    assert(pComparator != NULL);
+
+    //the nodes taken out, chained through listPrev from the last one taken to the first,
+    //their listNext stays as is so readers on them can go on
+    Node *removed = NULL;
+    Node *firstRemoved = NULL;
+    int count = 0;
+    //nodes in that chain, the others are kept for snapshots
+    size_t numReleased = 0;
+    //last node that stays, and whether cur was taken out with no node staying after it yet
+    NodeRef kept = 0;
+    bool isCurRemoved = false;
+
+    NodeRef ref = pList->head;
+    while (ref)
+    {
+        Node *node = s_node(ref);
+        NodeRef next = node->listNext;
+        void *pItem = s_item(pList, node);
+        if (pComparator(pItem, pComparisonArg))
+        {
+            RECORD_ITEM(pList, pItem);
+            if (pItemFreeFn)
+            {
+                (*pItemFreeFn)(pItem);
+            }
+            isCurRemoved |= ref == pList->cur;
+            ++count;
+            SNAPSHOT_TOUCH(node);
+            if (!SNAPSHOT_PARK(node))
+            {
+                node->listPrev = s_ref(removed);
+                removed = node;
+                if (!firstRemoved)
+                {
+                    firstRemoved = node;
+                }
+                ++numReleased;
+            }
+        }
+        else
+        {
+            //only link past the nodes taken out since the last node that stays
+            if (node->listPrev != kept)
+            {
+                SNAPSHOT_TOUCH(node);
+                if (kept)
+                {
+                    SNAPSHOT_TOUCH(s_node(kept));
+                }
+                node->listPrev = kept;
+                LINK_PUBLISH(*(kept ? &s_node(kept)->listNext : &pList->head), ref);
+            }
+            if (isCurRemoved)
+            {
+                pList->cur = ref;
+                isCurRemoved = false;
+            }
+            kept = ref;
+        }
+        ref = next;
+    }
+
+    RECORD(LIST_OP_REMOVE_IF, pList, 0, NULL);
+    if (!count)
+    {
+        return 0;
+    }
+    //cut off the nodes taken out after the last node that stays
+    if (kept)
+    {
+        SNAPSHOT_TOUCH(s_node(kept));
+    }
+    LINK_PUBLISH(*(kept ? &s_node(kept)->listNext : &pList->head), 0);
+    pList->tail = kept;
+    if (isCurRemoved)
+    {
+        pList->cur = 0;
+        pList->isBeforeHead = false;
+    }
+    pList->length -= count;
+
+    s_skip_invalidate(pList);
+    if (removed)
+    {
+        s_release_chain(removed, firstRemoved, numReleased);
+    }
+    return count;
+}
+
+// Returns the name of the List_* function for op, such as "List_add".
+const char *List_op_name(ListOp op)
+{
+    assert(op >= 0 && op < LIST_NUM_OPS);
+    return s_opNames[op];
+}
+
+#ifdef LIST_STATS
+// Copies the current statistics into pStats.
+void List_stats_get(ListStats *pStats)
+{
+    assert(pStats != NULL);
+    pStats->nodesInUse = __atomic_load_n(&s_stats.nodesInUse, __ATOMIC_RELAXED);
+    pStats->headsInUse = __atomic_load_n(&s_stats.headsInUse, __ATOMIC_RELAXED);
+    pStats->nodesHighWater = __atomic_load_n(&s_stats.nodesHighWater, __ATOMIC_RELAXED);
+    pStats->headsHighWater = __atomic_load_n(&s_stats.headsHighWater, __ATOMIC_RELAXED);
+    pStats->nodeFailures = __atomic_load_n(&s_stats.nodeFailures, __ATOMIC_RELAXED);
+    pStats->headFailures = __atomic_load_n(&s_stats.headFailures, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < LIST_NUM_OPS; ++i)
+    {
+        pStats->opCounts[i] = __atomic_load_n(&s_stats.opCounts[i], __ATOMIC_RELAXED);
+    }
+}
+
+// Clears the failure and operation counters, and lowers the high-water marks
+// to the current usage.
+void List_stats_reset()
+{
+    __atomic_store_n(&s_stats.nodesHighWater, __atomic_load_n(&s_stats.nodesInUse, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_store_n(&s_stats.headsHighWater, __atomic_load_n(&s_stats.headsInUse, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_store_n(&s_stats.nodeFailures, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_stats.headFailures, 0, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < LIST_NUM_OPS; ++i)
+    {
+        __atomic_store_n(&s_stats.opCounts[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+// Writes the statistics, including the length of every list in use, to pFile as
+// a single line JSON object. Returns 0 on success, -1 on a write error.
+int List_stats_dump_json(FILE *pFile)
+{
+    assert(pFile != NULL);
+    ListStats stats;
+    List_stats_get(&stats);
+
+    fprintf(pFile, "{\"nodesInUse\":%d,\"nodesHighWater\":%d,\"nodeCapacity\":%d,",
+            stats.nodesInUse, stats.nodesHighWater, LIST_MAX_NUM_NODES);
+    fprintf(pFile, "\"headsInUse\":%d,\"headsHighWater\":%d,\"headCapacity\":%d,",
+            stats.headsInUse, stats.headsHighWater, LIST_MAX_NUM_HEADS);
+    fprintf(pFile, "\"nodeFailures\":%llu,\"headFailures\":%llu,\"ops\":{",
+            stats.nodeFailures, stats.headFailures);
+    for (size_t i = 0; i < LIST_NUM_OPS; ++i)
+    {
+        fprintf(pFile, "%s\"%s\":%llu", i ? "," : "", s_opNames[i], stats.opCounts[i]);
+    }
+
+    //length of every head taken out of the pool, keyed by its slot
+    fprintf(pFile, "},\"lists\":[");
+    bool first = true;
+    for (size_t i = 0; i < s_pool->headHighWater; ++i)
+    {
+        if (!s_pool->heads[i].isFree)
+        {
+            fprintf(pFile, "%s{\"slot\":%zu,\"length\":%d}", first ? "" : ",", i, s_pool->heads[i].length);
+            first = false;
+        }
+    }
+    fprintf(pFile, "]}\n");
+
+    return ferror(pFile) ? -1 : 0;
+}
+#endif
+
+// Sorts pList in place by pOrder with a stable, bottom-up merge sort in O(n log n).
+// Nodes are relinked, never allocated, so this cannot fail. The current item stays
+// the same item, now at its sorted position; before the start and beyond the end stay as is.
+void List_sort(List *pList, ORDER_FN pOrder)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_SORT);
+    RECORD(LIST_OP_SORT, pList, 0, NULL);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    assert(pOrder != NULL);
+    s_skip_invalidate(pList);
+
+    //bins[i] holds a sorted run of 2^i nodes, like the digits of a binary counter
+    //every node is merged into the bins in a single pass over the list
+    //so the runs being merged are the most recently touched ones
+    Node *bins[sizeof(int) * 8] = {NULL};
+    size_t numBins = 0;
+    SNAPSHOT_TOUCH_LIST(pList);
+
+    Node *node = s_node(pList->head);
+    while (node)
+    {
+        Node *next = s_node(node->listNext);
+        node->listNext = 0;
+
+        //carry the new run up while the bin is taken
+        //bins hold earlier items, so they go first to keep the sort stable
+        Node *carry = node;
+        size_t i = 0;
+        for (; i < numBins && bins[i]; ++i)
+        {
+            carry = s_merge_chains(pList, bins[i], carry, pOrder);
+            bins[i] = NULL;
+        }
+        bins[i] = carry;
+        if (i == numBins)
+        {
+            ++numBins;
+        }
+        node = next;
+    }
+
+    //merge the remaining runs, larger bins hold earlier items
+    Node *sorted = NULL;
+    for (size_t i = 0; i < numBins; ++i)
+    {
+        if (bins[i])
+        {
+            sorted = sorted ? s_merge_chains(pList, bins[i], sorted, pOrder) : bins[i];
+        }
+    }
+
+    pList->head = s_ref(sorted);
+    s_relink_prev(pList);
+}
+
+// Merges pSrc into pDst in O(n), both must already be sorted by pOrder. Equal items
+// from pDst go before those from pSrc. The current pointer is set to the current pointer
+// of pDst. pSrc no longer exists after the operation; its head is available
+// for future operations.
+void List_merge(List *pDst, List *pSrc, ORDER_FN pOrder)
+{
+    s_List_assert(pDst);
+    s_List_assert(pSrc);
+    LIST_ENTER(LIST_OP_MERGE);
+    RECORD(LIST_OP_MERGE, pDst, RECORD_ID(pSrc), NULL);
+    SNAPSHOT_WRITE_ASSERT(pDst);
+    SNAPSHOT_WRITE_ASSERT(pSrc);
+    assert(pOrder != NULL);
+    assert(pDst != pSrc);
+    assert(pDst->itemSize == pSrc->itemSize);
+    s_skip_invalidate(pDst);
+    s_skip_invalidate(pSrc);
+
+    //the chains stay linked through listNext, so they can be merged directly
+    if (pSrc->head)
+    {
+        SNAPSHOT_TOUCH_LIST(pDst);
+        SNAPSHOT_TOUCH_LIST(pSrc);
+        pDst->head = s_ref(s_merge_chains(pDst, s_node(pDst->head), s_node(pSrc->head), pOrder));
+        s_relink_prev(pDst);
+    }
+
+    //add up the length
+    pDst->length += pSrc->length;
+
+    //the nodes now belong to pDst, reuse the head like List_concat does
+    s_push_free_head(pSrc);
+}
+
+//state of the xorshift generator picking index levels, one for each thread
+static __thread uint32_t s_skipRandom = 2463534242u;
+
+//number of index levels for a new node, each further level with a chance of 1 in 4
+static size_t s_skip_random_levels()
+{
+    s_skipRandom ^= s_skipRandom << 13;
+    s_skipRandom ^= s_skipRandom >> 17;
+    s_skipRandom ^= s_skipRandom << 5;
+    //every 2 low zero bits is one more level, the state is never 0
+    size_t levels = __builtin_ctz(s_skipRandom) / 2;
+    return levels < SKIP_MAX_LEVELS ? levels : SKIP_MAX_LEVELS;
+}
+
+//item of the list node an index node or list node stands for
+static void *s_skip_item(List *pList, Node *node, size_t level)
+{
+    return s_item(pList, level ? s_node(node->skipTarget) : node);
+}
+
+//build the sorted index of pList from scratch in one pass over the list,
+//giving every 4th node a first level, every 16th a second level and so on
+static void s_skip_build(List *pList)
+{
+    assert(!pList->skipIndex);
+    Node *headers[SKIP_MAX_LEVELS + 1] = {NULL};
+    Node *lastInLane[SKIP_MAX_LEVELS + 1] = {NULL};
+    size_t height = 0;
+
+    size_t position = 0;
+    for (Node *node = s_node(pList->head); node; node = s_node(node->listNext))
+    {
+        ++position;
+        size_t levels = __builtin_ctzl(position) / 2;
+        Node *down = node;
+        for (size_t level = 1; level <= levels && level <= SKIP_MAX_LEVELS; ++level)
+        {
+            //the tower needs a header for every lane
+            if (level > height)
+            {
+                Node *header = s_skip_pop_node();
+                if (!header)
+                {
+                    break;
+                }
+                header->listPrev = s_ref(headers[level - 1]);
+                headers[level] = header;
+                height = level;
+            }
+            Node *index = s_skip_pop_node();
+            if (!index)
+            {
+                break;
+            }
+            index->skipTarget = s_ref(node);
+            index->listPrev = s_ref(down);
+            if (lastInLane[level])
+            {
+                lastInLane[level]->listNext = s_ref(index);
+            }
+            else
+            {
+                headers[level]->listNext = s_ref(index);
+            }
+            lastInLane[level] = index;
+            down = index;
+        }
+    }
+    pList->skipIndex = s_ref(headers[height]);
+}
+
+// Adds item to pList after the last item that pOrder does not place after it, and makes
+// the new item the current one. pList must already be sorted by pOrder, e.g. by List_sort.
+// Returns 0 on success, -1 on failure.
+int List_insert_sorted(List *pList, void *pItem, ORDER_FN pOrder)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_INSERT_SORTED);
+    RECORD(LIST_OP_INSERT_SORTED, pList, 0, pItem);
+    SNAPSHOT_WRITE_ASSERT(pList);
+    assert(pOrder != NULL);
+
+    //the list node comes first, the index can do without its nodes
+    Node *new = s_pop_list_node(pList);
+    if (!new)
+    {
+        STAT_FAIL(nodeFailures);
+        return -1;
+    }
+    s_set_item(pList, new, pItem);
+
+    //from here on the index of pList is only given back by this thread
+    TS_LOCK(SKIP_LOCK(pList));
+    s_pSkipBusy = pList;
+
+    if (!pList->skipIndex && pList->head)
+    {
+        s_skip_build(pList);
+    }
+
+    //collect the header of every lane, from the top down
+    Node *headers[SKIP_MAX_LEVELS + 1] = {NULL};
+    size_t height = 0;
+    for (Node *header = s_node(pList->skipIndex); header; header = s_node(header->listPrev))
+    {
+        ++height;
+    }
+    size_t level = height;
+    for (Node *header = s_node(pList->skipIndex); header; header = s_node(header->listPrev))
+    {
+        headers[level--] = header;
+    }
+
+    //walk down the lanes, on each one stop at the last node not after the item
+    //preds[level] is that node, or NULL when the item goes before the whole lane
+    Node *preds[SKIP_MAX_LEVELS + 1] = {NULL};
+    Node *pred = NULL;
+    for (level = height; level > 0; --level)
+    {
+        Node *next = s_node(pred ? pred->listNext : headers[level]->listNext);
+        while (next && (*pOrder)(s_skip_item(pList, next, level), pItem) <= 0)
+        {
+            pred = next;
+            next = s_node(next->listNext);
+        }
+        preds[level] = pred;
+        //step down onto the node this one stands on
+        if (pred)
+        {
+            pred = s_node(pred->listPrev);
+        }
+    }
+    //finally walk the list itself the same way
+    Node *next = s_node(pred ? pred->listNext : pList->head);
+    while (next && (*pOrder)(s_item(pList, next), pItem) <= 0)
+    {
+        pred = next;
+        next = s_node(next->listNext);
+    }
+
+    //link the new node between pred and next
+    NodeRef newRef = s_ref(new);
+    new->listPrev = s_ref(pred);
+    new->listNext = s_ref(next);
+    if (pred)
+    {
+        SNAPSHOT_TOUCH(pred);
+        LINK_PUBLISH(pred->listNext, newRef);
+    }
+    else
+    {
+        LINK_PUBLISH(pList->head, newRef);
+    }
+    if (next)
+    {
+        SNAPSHOT_TOUCH(next);
+        next->listPrev = newRef;
+    }
+    else
+    {
+        pList->tail = newRef;
+    }
+    pList->cur = newRef;
+    pList->isBeforeHead = false;
+    ++(pList->length);
+
+    //give the new node a random tower, as far as spare nodes allow
+    size_t levels = s_skip_random_levels();
+    Node *down = new;
+    for (level = 1; level <= levels; ++level)
+    {
+        if (level > height)
+        {
+            Node *header = s_skip_pop_node();
+            if (!header)
+            {
+                break;
+            }
+            header->listPrev = s_ref(headers[height]);
+            pList->skipIndex = s_ref(header);
+            headers[++height] = header;
+        }
+        Node *index = s_skip_pop_node();
+        if (!index)
+        {
+            break;
+        }
+        index->skipTarget = newRef;
+        index->listPrev = s_ref(down);
+        if (preds[level])
+        {
+            index->listNext = preds[level]->listNext;
+            preds[level]->listNext = s_ref(index);
+        }
+        else
+        {
+            index->listNext = headers[level]->listNext;
+            headers[level]->listNext = s_ref(index);
+        }
+        down = index;
+    }
+
+    s_pSkipBusy = NULL;
+    TS_UNLOCK(SKIP_LOCK(pList));
+    return 0;
+}
+
+//write a 32 bit value, returns true on success
+static bool s_write_u32(FILE *pFile, uint32_t value)
+{
+    return fwrite(&value, sizeof(value), 1, pFile) == 1;
+}
+
+//read a 32 bit value, returns true on success
+static bool s_read_u32(FILE *pFile, uint32_t *pValue)
+{
+    return fread(pValue, sizeof(*pValue), 1, pFile) == 1;
+}
+
+// Writes the count lists of pLists to pFile in a compact binary format: for each list its
+// length, item size and the index of its current item, followed by its items in order.
+// Items of inline lists are written as is, other items through pSaveFn, which may be NULL
+// only if there are none. The lists are not changed. Returns 0 on success, -1 on failure.
+int List_save(FILE *pFile, List **pLists, int count, SAVE_FN pSaveFn)
+{
+    LIST_ENTER(LIST_OP_SAVE);
+    assert(pFile != NULL);
+    assert(count >= 0 && (count == 0 || pLists != NULL));
+
+    //the total tells the loader up front whether the pool can hold it all
+    uint32_t total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        s_List_assert(pLists[i]);
+        total += pLists[i]->length;
+    }
+    bool ok = s_write_u32(pFile, SAVE_MAGIC) && s_write_u32(pFile, SAVE_VERSION) &&
+              s_write_u32(pFile, count) && s_write_u32(pFile, total);
+
+    for (int i = 0; ok && i < count; ++i)
+    {
+        List *pList = pLists[i];
+
+        //links are not saved, the order of the items is enough
+        //so only the position of cur needs to be found
+        uint32_t curIndex = pList->isBeforeHead ? SAVE_BEFORE_HEAD : SAVE_BEYOND_END;
+        uint32_t index = 0;
+        for (NodeRef ref = pList->head; ref; ref = s_view(pList, ref)->listNext, ++index)
+        {
+            if (ref == pList->cur)
+            {
+                curIndex = index;
+            }
+        }
+        ok = s_write_u32(pFile, pList->length) && s_write_u32(pFile, pList->itemSize) &&
+             s_write_u32(pFile, curIndex);
+
+        for (Node *node = s_view(pList, pList->head); ok && node; node = s_view(pList, node->listNext))
+        {
+            if (pList->itemSize)
+            {
+                ok = fwrite(node->inlineData, pList->itemSize, 1, pFile) == 1;
+            }
+            else
+            {
+                assert(pSaveFn != NULL);
+                ok = (*pSaveFn)(pFile, node->data);
+            }
+        }
+    }
+
+    return ok && !ferror(pFile) ? 0 : -1;
+}
+
+// Reads lists written by List_save from pFile into the pool and stores them in pLists, in
+// the order they were saved, with the same current items. Items of inline lists are read
+// as is, other items through pLoadFn. The pool must not be in use: the lists are laid out
+// on the lowest heads and nodes, which are marked used in O(1), without going through
+// List_append. Returns the number of lists loaded, or -1 on failure, in which case
+// the pool is left empty and items already read by pLoadFn are not freed.
+int List_load(FILE *pFile, List **pLists, int maxCount, LOAD_FN pLoadFn)
+{
+    LIST_ENTER(LIST_OP_LOAD);
+    assert(pFile != NULL);
+    assert(maxCount >= 0 && (maxCount == 0 || pLists != NULL));
+
+    if (!s_pool->hasInit)
+    {
+        s_init();
+    }
+    ASYNC_FLUSH();
+    RCU_FLUSH();
+
+    //the lists are restored over the whole pool, so none may be in use
+    if (s_pool->numFreeNodes != LIST_MAX_NUM_NODES)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < s_pool->headHighWater; ++i)
+    {
+        if (!s_pool->heads[i].isFree)
+        {
+            return -1;
+        }
+    }
+    //start over from a pool where no head or node was ever used
+    s_init();
+
+    uint32_t magic, version, count, total;
+    if (!s_read_u32(pFile, &magic) || !s_read_u32(pFile, &version) ||
+        !s_read_u32(pFile, &count) || !s_read_u32(pFile, &total) ||
+        magic != SAVE_MAGIC || version != SAVE_VERSION ||
+        count > (uint32_t)maxCount || count > LIST_MAX_NUM_HEADS || total > LIST_MAX_NUM_NODES)
+    {
+        return -1;
+    }
+
+    //lay the lists out on consecutive heads and nodes, linking each node to the one before
+    size_t used = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        List *pList = s_pool->heads + i;
+        uint32_t length, itemSize, curIndex;
+        if (!s_read_u32(pFile, &length) || !s_read_u32(pFile, &itemSize) || !s_read_u32(pFile, &curIndex) ||
+            length > total - used || itemSize > LIST_INLINE_MAX_SIZE ||
+            (curIndex >= length && curIndex != SAVE_BEFORE_HEAD && curIndex != SAVE_BEYOND_END))
+        {
+            s_init();
+            return -1;
+        }
+
+        NodeRef first = used + 1;
+        for (uint32_t k = 0; k < length; ++k)
+        {
+            Node *node = s_node(first + k);
+            node->listPrev = k ? first + k - 1 : 0;
+            node->listNext = k + 1 < length ? first + k + 1 : 0;
+#ifdef LIST_SNAPSHOT
+            //stamps and versions left from before the load mean nothing to the new epoch
+            node->shadow = 0;
+#endif
+            SNAPSHOT_STAMP(node);
+
+            bool ok;
+            if (itemSize)
+            {
+                ok = fread(node->inlineData, itemSize, 1, pFile) == 1;
+            }
+            else
+            {
+                assert(pLoadFn != NULL);
+                ok = (*pLoadFn)(pFile, &node->data);
+            }
+            if (!ok)
+            {
+                s_init();
+                return -1;
+            }
+        }
+
+        pList->head = length ? first : 0;
+        pList->tail = length ? first + length - 1 : 0;
+        pList->cur = curIndex < length ? first + curIndex : 0;
+        pList->isBeforeHead = curIndex == SAVE_BEFORE_HEAD;
+        pList->length = length;
+        pList->skipIndex = 0;
+        pList->itemSize = itemSize;
+        used += length;
+    }
+    if (used != total)
+    {
+        s_init();
+        return -1;
+    }
+
+    //the loaded heads and nodes are the lowest ones, so the pool only
+    //has to know they have been used, the free head stack and the bitmap stay empty
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        s_pool->heads[i].isFree = false;
+        s_pool->heads[i].stackNext = 0;
+        pLists[i] = s_pool->heads + i;
+    }
+    s_pool->headHighWater = count;
+    for (size_t i = 0; i < s_pool->numPartitions; ++i)
+    {
+        NodePartition *part = s_pool->partitions + i;
+        size_t used = total < part->start ? part->start : total < part->end ? total : part->end;
+        //home nodes under the loaded ones are taken, the others stay free
+        for (size_t index = part->start; index < used && index < part->highWater; ++index)
+        {
+            s_pool->nodeFreeMap[index / 64] &= ~((uint64_t)1 << (index % 64));
+            --part->numFreeHome;
+        }
+        if (used > part->highWater)
+        {
+            part->highWater = used;
+        }
+        part->numFree = part->end - part->highWater + part->numFreeHome;
+    }
+    s_pool->numFreeNodes = LIST_MAX_NUM_NODES - total;
+    STAT_HEADS((int)count);
+    STAT_NODES((int)total);
+
+    return count;
+}
+
+//whether a mapped pool file holds a pool this build can use as is
+static bool s_pool_matches(ListPool *pool)
+{
+    //a new file is all zeros, s_create sets it up on the first List_create
+    if (pool->magic == 0 && !pool->hasInit)
+    {
+        return true;
+    }
+    return pool->magic == POOL_MAGIC && pool->version == POOL_VERSION &&
+           pool->numHeads == LIST_MAX_NUM_HEADS && pool->numNodes == LIST_MAX_NUM_NODES &&
+           pool->inlineMaxSize == LIST_INLINE_MAX_SIZE && pool->smallSize == LIST_SMALL_SIZE &&
+           pool->poolSize == sizeof(ListPool);
+}
+
+// Switches all List_* functions over to the heads and nodes stored in the file at path,
+// instead of the static pools. A missing or empty file is created and set up as an empty
+// pool. An existing pool file is mapped as is in O(1), with all the lists it held, which
+// are found again through List_from_id; it must have been made with the same
+// LIST_MAX_NUM_HEADS, LIST_MAX_NUM_NODES and LIST_INLINE_MAX_SIZE. A file under /dev/shm
+// gives a shared-memory pool that lasts until reboot. Returns 0 on success, or -1 if the
+// file cannot be mapped, does not hold a matching pool, or a pool file or a pool mapped
+// by List_pool_map is already in use.
+int List_pool_attach(const char *path, bool readOnly)
+{
+    LIST_ENTER(LIST_OP_POOL_ATTACH);
+    assert(path != NULL);
+    ASYNC_FLUSH();
+    RCU_FLUSH();
+
+    //only one pool file or mapped pool at a time
+    if (s_pool != &s_staticPool)
+    {
+        return -1;
+    }
+
+    int fd = open(path, readOnly ? O_RDONLY : O_RDWR | O_CREAT, 0666);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    //size a new file to hold the pool, the zeros it is filled with
+    //are an empty pool that has not been init'd yet, so there is nothing to write
+    struct stat fileStat;
+    bool ok = fstat(fd, &fileStat) == 0;
+    if (ok && fileStat.st_size == 0 && !readOnly)
+    {
+        ok = ftruncate(fd, sizeof(ListPool)) == 0;
+        fileStat.st_size = sizeof(ListPool);
+    }
+    ok = ok && fileStat.st_size == sizeof(ListPool);
+
+    //pages are only read in when they are touched, so this is O(1) in the pool size
+    void *mapping = MAP_FAILED;
+    if (ok)
+    {
+        mapping = mmap(NULL, sizeof(ListPool), readOnly ? PROT_READ : PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return -1;
+    }
+    if (!s_pool_matches(mapping))
+    {
+        munmap(mapping, sizeof(ListPool));
+        return -1;
+    }
+
+    s_pool = mapping;
+    s_poolMapSize = sizeof(ListPool);
+    s_poolPageSize = POOL_PAGE_SIZE;
+    STAT_SYNC();
+    return 0;
+}
+
+//map size bytes of anonymous memory starting on a multiple of align
+static void *s_map_aligned(size_t size, size_t align)
+{
+    //map enough to find an aligned start, then give back what is left over on both sides
+    char *mapping = mmap(NULL, size + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return MAP_FAILED;
+    }
+    char *start = (char *)(((uintptr_t)mapping + align - 1) & ~(uintptr_t)(align - 1));
+    if (start > mapping)
+    {
+        munmap(mapping, start - mapping);
+    }
+    munmap(start + size, mapping + align - start);
+    return start;
+}
+
+//read the online NUMA nodes into numaNodes, returns how many there are, at least 1
+static size_t s_online_numa_nodes(int *numaNodes, size_t maxCount)
+{
+    size_t count = 0;
+    //a list of ranges such as "0-1,4"
+    FILE *pFile = fopen("/sys/devices/system/node/online", "r");
+    int first, last;
+    while (pFile && count < maxCount && fscanf(pFile, "%d", &first) == 1)
+    {
+        last = first;
+        int separator = fgetc(pFile);
+        if (separator == '-' && fscanf(pFile, "%d", &last) == 1)
+        {
+            separator = fgetc(pFile);
+        }
+        for (int node = first; node <= last && count < maxCount; ++node)
+        {
+            numaNodes[count++] = node;
+        }
+        if (separator != ',')
+        {
+            break;
+        }
+    }
+    if (pFile)
+    {
+        fclose(pFile);
+    }
+    //no NUMA support, everything is on node 0
+    if (!count)
+    {
+        numaNodes[count++] = 0;
+    }
+    return count;
+}
+
+//split the empty node array into one partition per NUMA node and place each on its node
+static void s_place_partitions()
+{
+    int numaNodes[LIST_MAX_NUM_PARTITIONS];
+    size_t count = s_online_numa_nodes(numaNodes, LIST_MAX_NUM_PARTITIONS);
+    size_t size = ((LIST_MAX_NUM_NODES + count - 1) / count + 63) / 64 * 64;
+    //rounding up to whole bitmap words can leave nothing for the last partitions
+    count = (LIST_MAX_NUM_NODES + size - 1) / size;
+
+    s_pool->numPartitions = count;
+    s_pool->partitionSize = size;
+    for (size_t i = 0; i < count; ++i)
+    {
+        NodePartition *part = s_pool->partitions + i;
+        part->start = i * size;
+        part->end = part->start + size < LIST_MAX_NUM_NODES ? part->start + size : LIST_MAX_NUM_NODES;
+        s_reset_partition(part);
+        part->numaNode = numaNodes[i];
+
+        //no page of the partition has been touched yet, so all of them will be placed,
+        //pages shared with the next partition go to whichever touches them first
+        uintptr_t from = ((uintptr_t)(s_pool->nodes + part->start) + s_poolPageSize - 1) & ~(s_poolPageSize - 1);
+        uintptr_t to = (uintptr_t)(s_pool->nodes + part->end) & ~(s_poolPageSize - 1);
+        unsigned long mask = 1ul << part->numaNode;
+        if (to > from && part->numaNode < (int)sizeof(mask) * 8)
+        {
+            //a failure only costs the placement, the pool works all the same
+            syscall(SYS_mbind, from, to - from, POOL_MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0);
+        }
+    }
+}
+
+// Switches all List_* functions over to a new, empty pool in memory mapped for it and
+// placed as asked by flags, a combination of the LIST_POOL_* options. Where an option is
+// not available, such as on a machine without huge pages or with a single NUMA node, the
+// pool falls back to normal pages or a single partition. List_pool_detach releases the
+// pool, with all its lists. Returns 0 on success, or -1 if the memory cannot be mapped or
+// a pool file or mapped pool is already in use. Lists of the static pools are left as they
+// are, like for List_pool_attach.
+int List_pool_map(int flags)
+{
+    LIST_ENTER(LIST_OP_POOL_MAP);
+    ASYNC_FLUSH();
+    RCU_FLUSH();
+
+    //only one mapped pool at a time
+    if (s_pool != &s_staticPool)
+    {
+        return -1;
+    }
+
+    void *mapping;
+    size_t size = sizeof(ListPool);
+    size_t pageSize = POOL_PAGE_SIZE;
+    if (flags & LIST_POOL_HUGE_PAGES)
+    {
+        size = (size + POOL_HUGE_PAGE_SIZE - 1) / POOL_HUGE_PAGE_SIZE * POOL_HUGE_PAGE_SIZE;
+        //explicit huge pages can only be mapped while enough of them are reserved
+        mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapping != MAP_FAILED)
+        {
+            pageSize = POOL_HUGE_PAGE_SIZE;
+        }
+        //otherwise ask for transparent ones, which need the range to be aligned to them
+        else
+        {
+            mapping = s_map_aligned(size, POOL_HUGE_PAGE_SIZE);
+            if (mapping != MAP_FAILED)
+            {
+                madvise(mapping, size, MADV_HUGEPAGE);
+            }
+        }
+    }
+    else
+    {
+        mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (mapping == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    s_pool = mapping;
+    s_poolMapSize = size;
+    s_poolPageSize = pageSize;
+    //the pool is set up up front to be split, which only touches its first page and the home nodes
+    s_init();
+    if (flags & LIST_POOL_NUMA)
+    {
+        s_place_partitions();
+    }
+    STAT_SYNC();
+    return 0;
+}
+
+// Writes an attached pool back to its file, unmaps an attached or mapped pool, and
+// switches back to the static pools. Does nothing if the static pools are in use.
+void List_pool_detach()
+{
+    LIST_ENTER(LIST_OP_POOL_DETACH);
+    ASYNC_FLUSH();
+    RCU_FLUSH();
+    if (s_pool == &s_staticPool)
+    {
+        return;
+    }
+
+    msync(s_pool, s_poolMapSize, MS_SYNC);
+    munmap(s_pool, s_poolMapSize);
+    s_pool = &s_staticPool;
+    s_poolMapSize = 0;
+    s_poolPageSize = POOL_PAGE_SIZE;
+    STAT_SYNC();
+}
+
+//bytes of the address range from start to end backed by huge pages
+static size_t s_huge_page_bytes(uintptr_t start, uintptr_t end)
+{
+    FILE *pFile = fopen("/proc/self/smaps", "r");
+    if (!pFile)
+    {
+        return 0;
+    }
+    //each mapping starts with its address range, followed by one line per size
+    char line[256];
+    bool inRange = false;
+    size_t kB = 0;
+    while (fgets(line, sizeof(line), pFile))
+    {
+        unsigned long from, to;
+        size_t value;
+        if (sscanf(line, "%lx-%lx ", &from, &to) == 2)
+        {
+            inRange = from < end && to > start;
+        }
+        else if (inRange && (sscanf(line, "AnonHugePages: %zu kB", &value) == 1 ||
+                             sscanf(line, "Private_Hugetlb: %zu kB", &value) == 1 ||
+                             sscanf(line, "Shared_Hugetlb: %zu kB", &value) == 1))
+        {
+            kB += value;
+        }
+    }
+    fclose(pFile);
+    return kB * 1024;
+}
+
+// Fills pPlacement in with the placement of the pool in use, asking the kernel where its
+// pages are. Returns 0 on success, -1 if the kernel could not tell.
+int List_pool_placement(ListPlacement *pPlacement)
+{
+    LIST_ENTER(LIST_OP_POOL_PLACEMENT);
+    assert(pPlacement != NULL);
+    memset(pPlacement, 0, sizeof(*pPlacement));
+
+    pPlacement->pageSize = s_poolPageSize;
+    uintptr_t start = (uintptr_t)s_pool;
+    pPlacement->hugePageBytes = s_huge_page_bytes(start, start + (s_poolMapSize ? s_poolMapSize : sizeof(ListPool)));
+    //a pool that was never used is a single partition with nothing in it
+    if (!s_pool->hasInit)
+    {
+        pPlacement->numPartitions = 1;
+        pPlacement->partitions[0].numaNode = -1;
+        return 0;
+    }
+
+    pPlacement->numPartitions = s_pool->numPartitions;
+    for (size_t i = 0; i < s_pool->numPartitions; ++i)
+    {
+        NodePartition *part = s_pool->partitions + i;
+        pPlacement->partitions[i].numaNode = part->numaNode;
+        pPlacement->partitions[i].nodesInUse = part->end - part->start - part->numFree;
+
+        //ask for the NUMA node of every page of the nodes used so far, a batch at a time
+        uintptr_t page = (uintptr_t)(s_pool->nodes + part->start) & ~(s_poolPageSize - 1);
+        uintptr_t end = (uintptr_t)(s_pool->nodes + part->highWater);
+        while (page < end)
+        {
+            void *pages[64];
+            int status[64];
+            size_t count = 0;
+            for (; count < 64 && page < end; ++count, page += s_poolPageSize)
+            {
+                pages[count] = (void *)page;
+            }
+            if (syscall(SYS_move_pages, 0, count, pages, NULL, status, 0) != 0)
+            {
+                return -1;
+            }
+            //pages that were never touched have no node, a negative status
+            for (size_t k = 0; k < count; ++k)
+            {
+                if (status[k] >= 0 && (part->numaNode < 0 || status[k] == part->numaNode))
+                {
+                    ++pPlacement->partitions[i].pagesLocal;
+                }
+                else if (status[k] >= 0)
+                {
+                    ++pPlacement->partitions[i].pagesRemote;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Returns the slot of pList in the pool, which stands for the same list in every process
+// attached to the same pool file and after reattaching it.
+int List_id(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_ID);
+    return pList - s_pool->heads;
+}
+
+// Returns the list in slot id, or NULL if no list is using that slot.
+List *List_from_id(int id)
+{
+    LIST_ENTER(LIST_OP_FROM_ID);
+    if (id < 0 || (uint32_t)id >= s_pool->headHighWater || s_pool->heads[id].isFree)
+    {
+        return NULL;
+    }
+    return s_pool->heads + id;
+}
+
+// Returns a ref to the first node of pList, or 0 if pList is empty.
+NodeRef List_first_ref(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_FIRST_REF);
+    return LINK_READ(pList->head);
+}
+
+// Returns a ref to the last node of pList, or 0 if pList is empty.
+NodeRef List_last_ref(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_LAST_REF);
+    return pList->tail;
+}
+
+// Returns a ref to the node after ref in pList, or 0 at the end.
+NodeRef List_next_ref(List *pList, NodeRef ref)
+{
+    s_List_assert(pList);
+    s_ref_assert(ref);
+    LIST_ENTER(LIST_OP_NEXT_REF);
+    return LINK_READ(s_view(pList, ref)->listNext);
+}
+
+// Returns a ref to the node before ref in pList, or 0 at the start.
+NodeRef List_prev_ref(List *pList, NodeRef ref)
+{
+    s_List_assert(pList);
+    s_ref_assert(ref);
+    LIST_ENTER(LIST_OP_PREV_REF);
+    return s_view(pList, ref)->listPrev;
+}
+
+// Returns a pointer to the item of the node ref in pList.
+void *List_ref_item(List *pList, NodeRef ref)
+{
+    s_List_assert(pList);
+    s_ref_assert(ref);
+    LIST_ENTER(LIST_OP_REF_ITEM);
+    return s_item(pList, s_view(pList, ref));
+}
+
+// Returns a ref to the node an item of pList is stored in, which must be a list made by
+// List_create_inline and an item pointer handed out by a List_* function.
+NodeRef List_item_ref(List *pList, void *pItem)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_ITEM_REF);
+    assert(pList->itemSize);
+    //inline items are stored at the start of their node
+    NodeRef ref = s_ref((Node *)pItem);
+    s_ref_assert(ref);
+    return ref;
+}
+
+// Makes the node ref the current item of pList, or for ref 0 leaves the current pointer
+// beyond the end of pList, so List_add, List_insert and List_remove can work at any ref.
+void List_seek_ref(List *pList, NodeRef ref)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_SEEK_REF);
+    pList->cur = ref;
+    pList->isBeforeHead = false;
+}
+
+#ifdef LIST_SNAPSHOT
+// Makes a read-only snapshot of pList, or of the snapshot pList, with a copy of its current
+// item. Returns it on success, or a NULL pointer if there is no head left for it.
+List *List_snapshot(List *pList)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_SNAPSHOT);
+    List *pSnapshot = s_create();
+    if (!pSnapshot)
+    {
+        return NULL;
+    }
+
+    //nodes keep their versions from now on, a snapshot of a snapshot reads the same ones
+    uint32_t epoch = pList->snapshotEpoch;
+    if (!epoch)
+    {
+        assert(s_pool->epoch < SNAPSHOT_BROKEN - 1);
+        epoch = s_pool->epoch++;
+        s_pool->snapshotEpoch = epoch;
+    }
+    pSnapshot->head = pList->head;
+    pSnapshot->tail = pList->tail;
+    pSnapshot->cur = pList->cur;
+    pSnapshot->isBeforeHead = pList->isBeforeHead;
+    pSnapshot->length = pList->length;
+    pSnapshot->itemSize = pList->itemSize;
+    pSnapshot->snapshotEpoch = epoch;
+    ++s_pool->numSnapshots;
+    return pSnapshot;
+}
+
+// Returns false if pSnapshot was emptied because the pool ran out of nodes for old versions.
+bool List_snapshot_is_valid(List *pSnapshot)
+{
+    s_List_assert(pSnapshot);
+    LIST_ENTER(LIST_OP_SNAPSHOT_IS_VALID);
+    assert(pSnapshot->snapshotEpoch);
+    return pSnapshot->snapshotEpoch != SNAPSHOT_BROKEN;
+}
+
+// Gives the head of pSnapshot back, and with the last snapshot every old version.
+void List_snapshot_release(List *pSnapshot)
+{
+    s_List_assert(pSnapshot);
+    LIST_ENTER(LIST_OP_SNAPSHOT_RELEASE);
+    assert(pSnapshot->snapshotEpoch);
+    s_push_free_head(pSnapshot);
+    //versions are shared by the snapshots, only the last one can give them back
+    if (--s_pool->numSnapshots == 0)
+    {
+        s_pool->snapshotEpoch = 0;
+        s_snapshot_free_versions();
+    }
+}
+#endif
+
+#ifdef LIST_RCU
+// Enters a read-side critical section of the calling thread, which may be nested. Inside it
+// the thread may walk lists with List_rcu_search, List_first_ref and List_next_ref while
+// another thread changes them, and nodes it can reach are not recycled until it leaves.
+void List_rcu_read_lock()
+{
+    if (s_rcuDepth++)
+    {
+        return;
+    }
+    //claim a slot on the first read lock of the thread
+    for (size_t i = 0; s_rcuSlot < 0 && i < LIST_RCU_MAX_READERS; ++i)
+    {
+        if (!__atomic_exchange_n(&s_rcuSlots[i].isTaken, true, __ATOMIC_ACQUIRE))
+        {
+            s_rcuSlot = i;
+            __atomic_add_fetch(&s_rcuNumReaders, 1, __ATOMIC_SEQ_CST);
+        }
+    }
+    assert(s_rcuSlot >= 0);
+
+    RcuSlot *slot = s_rcuSlots + s_rcuSlot;
+    __atomic_store_n(&slot->epoch, __atomic_load_n(&s_rcuEpoch, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+    //writers must see the slot taken before any link is read
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// Leaves the read-side critical section entered by the matching List_rcu_read_lock.
+// Items found inside it must not be used anymore.
+void List_rcu_read_unlock()
+{
+    assert(s_rcuDepth > 0);
+    if (--s_rcuDepth == 0)
+    {
+        __atomic_store_n(&s_rcuSlots[s_rcuSlot].epoch, 0, __ATOMIC_RELEASE);
+    }
+}
+
+// Gives the reader slot of the calling thread back, for threads that are about to exit.
+void List_rcu_thread_exit()
+{
+    assert(s_rcuDepth == 0);
+    if (s_rcuSlot >= 0)
+    {
+        __atomic_sub_fetch(&s_rcuNumReaders, 1, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&s_rcuSlots[s_rcuSlot].isTaken, false, __ATOMIC_RELEASE);
+        s_rcuSlot = -1;
+    }
+}
+
+// Searches pList from its first item for one that pComparator matches with pComparisonArg,
+// like List_search but without moving the current item, and returns it, or NULL if there
+// is none. Must be called inside a read-side critical section, and the item stays valid
+// until it is left.
+void *List_rcu_search(List *pList, COMPARATOR_FN pComparator, void *pComparisonArg)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_RCU_SEARCH);
+    assert(s_rcuDepth > 0);
+
+    for (NodeRef ref = LINK_READ(pList->head); ref; ref = LINK_READ(s_node(ref)->listNext))
+    {
+        void *pItem = s_item(pList, s_node(ref));
+        if (pComparator(pItem, pComparisonArg))
+        {
+            return pItem;
+        }
+    }
     return NULL;
 }
+
+// Waits until every reader that may still be on a node taken out of a list has left its
+// read-side critical section, and recycles all such nodes. Must be called by the writer,
+// outside of a read-side critical section.
+void List_rcu_synchronize()
+{
+    LIST_ENTER(LIST_OP_RCU_SYNCHRONIZE);
+    assert(s_rcuDepth == 0);
+    s_rcu_synchronize();
+}
+#endif
+
+#ifdef LIST_THREAD_SAFE
+//lock of a head, which must be in the pool even if it is free
+static inline SpinLock *s_list_lock(List *pList)
+{
+    assert(pList >= s_pool->heads && pList < s_pool->heads + LIST_MAX_NUM_HEADS);
+    return s_listLocks + (pList - s_pool->heads);
+}
+
+//lock two lists in address order, so no two threads can each hold the lock the other waits for
+static void s_lock_pair(List *pList1, List *pList2)
+{
+    if (pList1 > pList2)
+    {
+        List *pTemp = pList1;
+        pList1 = pList2;
+        pList2 = pTemp;
+    }
+    s_lock(s_list_lock(pList1));
+    if (pList2 != pList1)
+    {
+        s_lock(s_list_lock(pList2));
+    }
+}
+
+static void s_unlock_pair(List *pList1, List *pList2)
+{
+    s_unlock(s_list_lock(pList1));
+    if (pList2 != pList1)
+    {
+        s_unlock(s_list_lock(pList2));
+    }
+}
+
+// Takes the lock of pList, waiting while another thread holds it.
+// Locks are not recursive: the List_ts_* functions must not be called on pList until
+// List_ts_unlock, the plain List_* functions are used instead.
+void List_ts_lock(List *pList)
+{
+    s_lock(s_list_lock(pList));
+}
+
+// Gives back the lock of pList taken by List_ts_lock.
+void List_ts_unlock(List *pList)
+{
+    s_unlock(s_list_lock(pList));
+}
+
+// Like List_count, holding the lock of pList.
+int List_ts_count(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    int count = List_count(pList);
+    s_unlock(s_list_lock(pList));
+    return count;
+}
+
+// Like List_first, holding the lock of pList.
+void *List_ts_first(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_first(pList);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_last, holding the lock of pList.
+void *List_ts_last(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_last(pList);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_next, holding the lock of pList.
+void *List_ts_next(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_next(pList);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_prev, holding the lock of pList.
+void *List_ts_prev(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_prev(pList);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_curr, holding the lock of pList.
+void *List_ts_curr(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_curr(pList);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_add, holding the lock of pList.
+int List_ts_add(List *pList, void *pItem)
+{
+    s_lock(s_list_lock(pList));
+    int result = List_add(pList, pItem);
+    s_unlock(s_list_lock(pList));
+    return result;
+}
+
+// Like List_insert, holding the lock of pList.
+int List_ts_insert(List *pList, void *pItem)
+{
+    s_lock(s_list_lock(pList));
+    int result = List_insert(pList, pItem);
+    s_unlock(s_list_lock(pList));
+    return result;
+}
+
+// Like List_append, holding the lock of pList.
+int List_ts_append(List *pList, void *pItem)
+{
+    s_lock(s_list_lock(pList));
+    int result = List_append(pList, pItem);
+    s_unlock(s_list_lock(pList));
+    return result;
+}
+
+// Like List_prepend, holding the lock of pList.
+int List_ts_prepend(List *pList, void *pItem)
+{
+    s_lock(s_list_lock(pList));
+    int result = List_prepend(pList, pItem);
+    s_unlock(s_list_lock(pList));
+    return result;
+}
+
+// Like List_append_all, holding the lock of pList.
+int List_ts_append_all(List *pList, void **pItems, int count)
+{
+    s_lock(s_list_lock(pList));
+    int result = List_append_all(pList, pItems, count);
+    s_unlock(s_list_lock(pList));
+    return result;
+}
+
+// Like List_remove, holding the lock of pList.
+void *List_ts_remove(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_remove(pList);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_free, holding the lock of pList.
+void List_ts_free(List *pList, FREE_FN pItemFreeFn)
+{
+    s_lock(s_list_lock(pList));
+    List_free(pList, pItemFreeFn);
+    s_unlock(s_list_lock(pList));
+}
+
+// Like List_trim, holding the lock of pList.
+void *List_ts_trim(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_trim(pList);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_push_back, holding the lock of pList.
+int List_ts_push_back(List *pList, void *pItem)
+{
+    s_lock(s_list_lock(pList));
+    int result = List_push_back(pList, pItem);
+    s_unlock(s_list_lock(pList));
+    return result;
+}
+
+// Like List_push_front, holding the lock of pList.
+int List_ts_push_front(List *pList, void *pItem)
+{
+    s_lock(s_list_lock(pList));
+    int result = List_push_front(pList, pItem);
+    s_unlock(s_list_lock(pList));
+    return result;
+}
+
+// Like List_pop_back, holding the lock of pList.
+void *List_ts_pop_back(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_pop_back(pList);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_pop_front, holding the lock of pList.
+void *List_ts_pop_front(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_pop_front(pList);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_search, holding the lock of pList.
+void *List_ts_search(List *pList, COMPARATOR_FN pComparator, void *pComparisonArg)
+{
+    s_lock(s_list_lock(pList));
+    void *pItem = List_search(pList, pComparator, pComparisonArg);
+    s_unlock(s_list_lock(pList));
+    return pItem;
+}
+
+// Like List_remove_if, holding the lock of pList.
+int List_ts_remove_if(List *pList, COMPARATOR_FN pComparator, void *pComparisonArg, FREE_FN pItemFreeFn)
+{
+    s_lock(s_list_lock(pList));
+    int count = List_remove_if(pList, pComparator, pComparisonArg, pItemFreeFn);
+    s_unlock(s_list_lock(pList));
+    return count;
+}
+
+// Like List_clone, holding the lock of pList.
+List *List_ts_clone(List *pList)
+{
+    s_lock(s_list_lock(pList));
+    List *pClone = List_clone(pList);
+    s_unlock(s_list_lock(pList));
+    return pClone;
+}
+
+// Like List_clone_range, holding the lock of pList.
+List *List_ts_clone_range(List *pList, NodeRef first, NodeRef last)
+{
+    s_lock(s_list_lock(pList));
+    List *pClone = List_clone_range(pList, first, last);
+    s_unlock(s_list_lock(pList));
+    return pClone;
+}
+
+// Like List_sort, holding the lock of pList.
+void List_ts_sort(List *pList, ORDER_FN pOrder)
+{
+    s_lock(s_list_lock(pList));
+    List_sort(pList, pOrder);
+    s_unlock(s_list_lock(pList));
+}
+
+// Like List_insert_sorted, holding the lock of pList.
+int List_ts_insert_sorted(List *pList, void *pItem, ORDER_FN pOrder)
+{
+    s_lock(s_list_lock(pList));
+    int result = List_insert_sorted(pList, pItem, pOrder);
+    s_unlock(s_list_lock(pList));
+    return result;
+}
+
+// Like List_concat and List_merge, holding the locks of both lists. The locks are taken
+// in address order, so two threads concatenating the same two lists either way round
+// cannot deadlock.
+void List_ts_concat(List *pList1, List *pList2)
+{
+    s_lock_pair(pList1, pList2);
+    List_concat(pList1, pList2);
+    s_unlock_pair(pList1, pList2);
+}
+
+// Like List_merge, holding the locks of both lists, taken in address order.
+void List_ts_merge(List *pDst, List *pSrc, ORDER_FN pOrder)
+{
+    s_lock_pair(pDst, pSrc);
+    List_merge(pDst, pSrc, pOrder);
+    s_unlock_pair(pDst, pSrc);
+}
+#endif
+
+#ifdef LIST_ASYNC_FREE
+// Deletes pList like List_free, calling pItemFreeFn on its items on the reclaimer thread.
+// pList no longer exists after the operation and its head is available at once, its nodes
+// once the reclaimer is done with them. If the reclaimer thread cannot be started, pList
+// is freed on the calling thread.
+void List_free_async(List *pList, FREE_FN pItemFreeFn)
+{
+    s_List_assert(pList);
+    LIST_ENTER(LIST_OP_FREE_ASYNC);
+    RECORD(LIST_OP_FREE_ASYNC, pList, 0, NULL);
+    assert(pItemFreeFn != NULL);
+    s_skip_invalidate(pList);
+
+    //the nodes stay linked through listNext, only the head lets go of them
+    if (pList->head)
+    {
+        AsyncJob job = {pList->head, pList->tail, pList->length, pList->itemSize, pItemFreeFn};
+        if (!s_async_queue(&job))
+        {
+            s_async_reclaim(&job);
+        }
+    }
+    s_push_free_head(pList);
+}
+
+// Waits until the reclaimer is done with every list freed by List_free_async so far.
+void List_free_async_flush()
+{
+    LIST_ENTER(LIST_OP_FREE_ASYNC_FLUSH);
+    s_async_flush();
+}
+
+// Waits like List_free_async_flush, then stops the reclaimer thread, e.g. before the
+// program exits. The next List_free_async starts it again.
+void List_free_async_stop()
+{
+    LIST_ENTER(LIST_OP_FREE_ASYNC_STOP);
+    pthread_mutex_lock(&s_asyncMutex);
+    if (!s_asyncStarted)
+    {
+        pthread_mutex_unlock(&s_asyncMutex);
+        return;
+    }
+    //the reclaimer empties the ring before it stops
+    s_asyncStopping = true;
+    pthread_cond_signal(&s_asyncWork);
+    pthread_mutex_unlock(&s_asyncMutex);
+    pthread_join(s_asyncThread, NULL);
+
+    pthread_mutex_lock(&s_asyncMutex);
+    s_asyncStarted = false;
+    s_asyncStopping = false;
+    pthread_mutex_unlock(&s_asyncMutex);
+}
+
+// Like List_free_async, holding the lock of pList.
+void List_ts_free_async(List *pList, FREE_FN pItemFreeFn)
+{
+    s_lock(s_list_lock(pList));
+    List_free_async(pList, pItemFreeFn);
+    s_unlock(s_list_lock(pList));
+}
+#endif
@@ -7,51 +7,135 @@
 #ifndef _LIST_H_
 #define _LIST_H_
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Largest item size of lists made by List_create_inline, whose items are stored
+// inside the nodes. Nodes grow beyond one pointer of data if this is made larger.
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_INLINE_MAX_SIZE
+#define LIST_INLINE_MAX_SIZE sizeof(void*)
+#endif
+
+// Reference to a node: its position in the node pool plus one, or 0 for no node.
+// Links are stored as refs instead of pointers so that they stay valid in a pool
+// attached from a file at a different address, see List_pool_attach.
+typedef uint32_t NodeRef;
 
 typedef struct Node_s Node;
 struct Node_s {
-    // TODO: You should change this!
-    void* data;
+    //item pointer, or the item itself for lists made by List_create_inline
+    union {
+        void* data;
+        unsigned char inlineData[LIST_INLINE_MAX_SIZE];
+        //list node a node of a skip list index stands for
+        NodeRef skipTarget;
+    };
 
     //double linked list
-    Node* listPrev;
-    Node* listNext;
-    
-    //stack linked list
-    Node* stackNext;
-    //stack guard to prevent pushing existing node
-    //which will corrupt the linked list linkage 
-    bool isFree;
+    NodeRef listPrev;
+    NodeRef listNext;
+
+#ifdef LIST_SNAPSHOT
+    //older version of the node kept for snapshots that still see it, 0 if there is none
+    NodeRef shadow;
+    //snapshot epoch the current version of the node was made in
+    uint32_t stamp;
+#endif
+
+    //free nodes are tracked by a bitmap in list.c,
+    //so a node carries no pool bookkeeping of its own
 };
 
+// Size of a cache line, heads are aligned to it with -DLIST_ALIGNED_HEADS
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_CACHE_LINE_SIZE
+#define LIST_CACHE_LINE_SIZE 64
+#endif
+
+// With -DLIST_ALIGNED_HEADS every head starts a cache line and is padded to whole lines,
+// so threads working on lists next to each other in the head pool never write the same
+// line. Otherwise heads are packed, several to a line.
+#ifdef LIST_ALIGNED_HEADS
+#define LIST_HEAD_ALIGNMENT __attribute__((aligned(LIST_CACHE_LINE_SIZE)))
+#else
+#define LIST_HEAD_ALIGNMENT
+#endif
+
 typedef struct List_s List;
 struct List_s {
     // TODO: You should change this!
 
+    //the fields written by almost every call come first, together on one line
+
     //store head and tail to preform O(1) append and prepend
-    Node* head;
-    Node* tail;
-    Node* cur;
+    NodeRef head;
+    NodeRef tail;
+    NodeRef cur;
+    int length;
 
     //use this boolean to distinguish before head and beyond end
     bool isBeforeHead;
-    int length;
 
-    //stack linked list
-    List* stackNext;
+    //top of the skip list index used by List_insert_sorted, 0 if there is none
+    NodeRef skipIndex;
+
+    //size of the items stored inside the nodes, 0 if nodes hold item pointers
+    size_t itemSize;
+    //copy of the item last taken out by List_remove, List_trim or a pop of an inline list
+    union {
+        void* removedAlign;
+        unsigned char removedItem[LIST_INLINE_MAX_SIZE];
+    };
+
+#ifdef LIST_SNAPSHOT
+    //epoch of a snapshot made by List_snapshot, 0 for a list that can be changed
+    uint32_t snapshotEpoch;
+#endif
+
+    //head pool bookkeeping last, only written when the head is taken or given back
+
+    //stack linked list, slot of the next free head plus one, 0 at the bottom
+    uint32_t stackNext;
     //stack guard to prevent pushing existing node
     //which will corrupt the linked list linkage 
     bool isFree;
-};
+} LIST_HEAD_ALIGNMENT;
 
 // Maximum number of unique lists the system can support
-// (You may modify its value for your needs)
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_MAX_NUM_HEADS
 #define LIST_MAX_NUM_HEADS 10
+#endif
 
 // Maximum total number of nodes (statically allocated) to be shared across all lists
-// (You may modify its value for your needs)
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_MAX_NUM_NODES
 #define LIST_MAX_NUM_NODES 100
+#endif
+
+// Maximum number of NUMA nodes the node pool can be split across by List_pool_map
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_MAX_NUM_PARTITIONS
+#define LIST_MAX_NUM_PARTITIONS 8
+#endif
+
+// Number of home nodes of each head, which its list takes its first items from, 0 for none.
+// This is a placement hint for locality only: the home nodes of a head are next to each
+// other at the start of the node array, so the items of a small list share a cache line or
+// two and are taken without searching the pool. They are ordinary pool nodes, so every
+// item still takes a node and the pool holds exactly as many items as without them; the
+// other nodes are handed out first, and home nodes only go to other lists once nothing
+// else is left. Off by default. Must divide 64.
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_SMALL_SIZE
+#define LIST_SMALL_SIZE 0
+#endif
 
 // General Error Handling:
 // Client code is assumed never to call these functions with a NULL List pointer, or 
@@ -62,9 +146,26 @@ struct List_s {
 // Returns a NULL pointer on failure.
 List* List_create();
 
+// Makes a new, empty list whose items are itemSize byte values stored inside the
+// nodes instead of pointers to items stored elsewhere. itemSize must be between 1 and
+// LIST_INLINE_MAX_SIZE, and items must not need more alignment than a pointer.
+// Returns its reference on success, or a NULL pointer on failure.
+//
+// For such a list every pItem passed in points to a value that is copied into the node,
+// and every item pointer handed out (by List_curr, List_search, to comparators, to
+// pItemFreeFn, ...) points into the node, so it is valid while the item is in the list.
+// List_remove, List_trim, List_pop_back and List_pop_front return a pointer to a copy of the
+// item kept in the list head, which is valid until the next of them or List_free on that list.
+// Lists can only be concatenated or merged with lists of the same item size.
+List* List_create_inline(size_t itemSize);
+
 // Returns the number of items in pList.
 int List_count(List* pList);
 
+// Returns the number of nodes still available in the shared node pool, including the ones
+// the indexes of List_insert_sorted hold, as they are given back whenever a list needs them.
+int List_free_node_count();
+
 // Returns a pointer to the first item in pList and makes the first item the current item.
 // Returns NULL and sets current item to NULL if list is empty.
 void* List_first(List* pList);
@@ -106,6 +207,25 @@ int List_append(List* pList, void* pItem);
 // Returns 0 on success, -1 on failure.
 int List_prepend(List* pList, void* pItem);
 
+// Adds count items from pItems to the end of pList, in order, and makes the last added
+// item the current one. The nodes are reserved from the pool in one step, so either all
+// items are added or, if the pool cannot hold them, none are and pList is unchanged.
+// Returns 0 on success, -1 on failure.
+int List_append_all(List* pList, void** pItems, int count);
+
+// Makes a new list holding a copy of every item of pList in the same order, whose current
+// item is the copy of the current item of pList. All nodes are taken from the pool in one
+// step and linked in one pass, so on failure nothing is taken. Items of lists not made by
+// List_create_inline are pointers, which are copied as they are.
+// Returns the new list on success, or a NULL pointer if there is no head or not enough
+// nodes left.
+List* List_clone(List* pList);
+
+// Like List_clone, for the items of pList from the node first to the node last, both refs of
+// pList with last not before first. The current item of the new list is the copy of the
+// current item of pList if it is in the range, otherwise it is before the start.
+List* List_clone_range(List* pList, NodeRef first, NodeRef last);
+
 // Return current item and take it out of pList. Make the next item the current one.
 // If the current pointer is before the start of the pList, or beyond the end of the pList,
 // then do not change the pList and return NULL.
@@ -128,6 +248,18 @@ void List_free(List* pList, FREE_FN pItemFreeFn);
 // Return NULL if pList is initially empty.
 void* List_trim(List* pList);
 
+// Deque operations, for lists used from both ends without the current item.
+// They take the shortest path there is and leave the current item where it is, unless
+// it is the item popped, which then moves on like List_remove and List_trim would move it:
+// to the new first item for List_pop_front and to the new last item for List_pop_back.
+//
+// Add pItem to the back or the front of pList. Return 0 on success, -1 on failure.
+int List_push_back(List* pList, void* pItem);
+int List_push_front(List* pList, void* pItem);
+// Return the last or first item and take it out of pList. Return NULL if pList is empty.
+void* List_pop_back(List* pList);
+void* List_pop_front(List* pList);
+
 // Search pList, starting at the current item, until the end is reached or a match is found. 
 // In this context, a match is determined by the comparator parameter. This parameter is a
 // pointer to a routine that takes as its first argument an item pointer, and as its second 
@@ -144,4 +276,441 @@ void* List_trim(List* pList);
 typedef bool (*COMPARATOR_FN)(void* pItem, void* pComparisonArg);
 void* List_search(List* pList, COMPARATOR_FN pComparator, void* pComparisonArg);
 
+// Takes every item of pList that pComparator matches with pComparisonArg out of pList, in
+// one pass from the first item, calling pItemFreeFn on each of them unless it is NULL.
+// Returns the number of items taken out. The nodes go back to the pool together at the end.
+//
+// If the current item is taken out, the next item that stays becomes the current one, or
+// the current pointer is left beyond the end of the list if there is none. Otherwise the
+// current item, and before the start and beyond the end, stay as is.
+int List_remove_if(List* pList, COMPARATOR_FN pComparator, void* pComparisonArg, FREE_FN pItemFreeFn);
+
+// Orders two items. Returns a negative number if pItem1 goes before pItem2, a positive
+// number if it goes after, or 0 if they are equal.
+typedef int (*ORDER_FN)(void* pItem1, void* pItem2);
+
+// Sorts pList in place by pOrder with a stable, bottom-up merge sort in O(n log n).
+// Nodes are relinked, never allocated, so this cannot fail. The current item stays
+// the same item, now at its sorted position; before the start and beyond the end stay as is.
+void List_sort(List* pList, ORDER_FN pOrder);
+
+// Merges pSrc into pDst in O(n), both must already be sorted by pOrder. Equal items
+// from pDst go before those from pSrc. The current pointer is set to the current pointer
+// of pDst. pSrc no longer exists after the operation; its head is available
+// for future operations.
+void List_merge(List* pDst, List* pSrc, ORDER_FN pOrder);
+
+// Adds item to pList after the last item that pOrder does not place after it, and makes
+// the new item the current one. pList must already be sorted by pOrder, e.g. by List_sort.
+// Returns 0 on success, -1 on failure.
+//
+// Positions are found in O(log n) through a skip list index over the nodes of pList.
+// The index is built from spare pool nodes, only while at least an eighth of the pool
+// is free, and dropped, giving its nodes back to the pool, by any other change to pList
+// or as soon as any list finds no free node, so it never keeps nodes from other lists.
+// It is rebuilt in O(n) on the next List_insert_sorted.
+int List_insert_sorted(List* pList, void* pItem, ORDER_FN pOrder);
+
+// Writes one item of a list to pFile. Returns true on success.
+typedef bool (*SAVE_FN)(FILE* pFile, void* pItem);
+// Reads one item written by the matching SAVE_FN from pFile into *ppItem. Returns true on success.
+typedef bool (*LOAD_FN)(FILE* pFile, void** ppItem);
+
+// Writes the count lists of pLists to pFile in a compact binary format: for each list its
+// length, item size and the index of its current item, followed by its items in order.
+// Items of inline lists are written as is, other items through pSaveFn, which may be NULL
+// only if there are none. The lists are not changed. Returns 0 on success, -1 on failure.
+int List_save(FILE* pFile, List** pLists, int count, SAVE_FN pSaveFn);
+
+// Reads lists written by List_save from pFile into the pool and stores them in pLists, in
+// the order they were saved, with the same current items. Items of inline lists are read
+// as is, other items through pLoadFn. The pool must not be in use: the lists are laid out
+// on the lowest heads and nodes, which are marked used in O(1), without going through
+// List_append. Returns the number of lists loaded, or -1 on failure, in which case
+// the pool is left empty and items already read by pLoadFn are not freed.
+int List_load(FILE* pFile, List** pLists, int maxCount, LOAD_FN pLoadFn);
+
+// Switches all List_* functions over to the heads and nodes stored in the file at path,
+// instead of the static pools. A missing or empty file is created and set up as an empty
+// pool. An existing pool file is mapped as is in O(1), with all the lists it held, which
+// are found again through List_from_id; it must have been made with the same
+// LIST_MAX_NUM_HEADS, LIST_MAX_NUM_NODES and LIST_INLINE_MAX_SIZE. A file under /dev/shm
+// gives a shared-memory pool that lasts until reboot. Returns 0 on success, or -1 if the
+// file cannot be mapped, does not hold a matching pool, or a pool file or a pool mapped
+// by List_pool_map is already in use.
+//
+// Lists of the static pools are left as they are and can be used again after
+// List_pool_detach, but not while a file is attached, and the other way around.
+//
+// Any number of processes may attach the same file with readOnly set, but at most one may
+// attach it for writing, and a writer that dies in the middle of a List_* call may leave
+// the pool inconsistent. A read-only process may only call List_from_id, List_id,
+// List_count, List_free_node_count and the List_*_ref functions, as every other function
+// writes to the pool. Readers take no locks, so they must only look at lists the writer
+// is not changing at the same time. Items of lists not made by List_create_inline are
+// pointers, which only mean something in the process that added them, so lists that are
+// shared or kept across restarts should be inline lists.
+int List_pool_attach(const char* path, bool readOnly);
+
+// Writes an attached pool back to its file, unmaps an attached or mapped pool, and
+// switches back to the static pools. Does nothing if the static pools are in use.
+void List_pool_detach();
+
+// Options for List_pool_map.
+// Back the pool with 2MB huge pages: explicit ones if enough are reserved through
+// vm.nr_hugepages, or else transparent ones, as far as the kernel hands them out.
+#define LIST_POOL_HUGE_PAGES 0x1
+// Split the nodes into one partition per NUMA node, each placed in the memory of its NUMA
+// node. Threads take nodes from the partition of the NUMA node they run on, and only from
+// the others once it is full.
+#define LIST_POOL_NUMA 0x2
+
+// Switches all List_* functions over to a new, empty pool in memory mapped for it and
+// placed as asked by flags, a combination of the LIST_POOL_* options. Where an option is
+// not available, such as on a machine without huge pages or with a single NUMA node, the
+// pool falls back to normal pages or a single partition. List_pool_detach releases the
+// pool, with all its lists. Returns 0 on success, or -1 if the memory cannot be mapped or
+// a pool file or mapped pool is already in use. Lists of the static pools are left as they
+// are, like for List_pool_attach.
+int List_pool_map(int flags);
+
+// Where the memory of the pool actually is.
+typedef struct ListPlacement_s ListPlacement;
+struct ListPlacement_s {
+    //size of the pages the pool was mapped with, 2MB for explicit huge pages
+    size_t pageSize;
+    //bytes of the pool backed by huge pages, explicit or transparent
+    size_t hugePageBytes;
+    //partitions of the node pool
+    int numPartitions;
+    struct {
+        //NUMA node the partition is placed on, -1 if it is not placed
+        int numaNode;
+        //nodes of the partition taken out of the pool
+        int nodesInUse;
+        //pages holding nodes of the partition on its own NUMA node, and on other ones,
+        //pages that were never touched are not counted, and all pages of a partition
+        //that is not placed count as local
+        int pagesLocal;
+        int pagesRemote;
+    } partitions[LIST_MAX_NUM_PARTITIONS];
+};
+
+// Fills pPlacement in with the placement of the pool in use, asking the kernel where its
+// pages are. Returns 0 on success, -1 if the kernel could not tell.
+int List_pool_placement(ListPlacement* pPlacement);
+
+// Returns the slot of pList in the pool, which stands for the same list in every process
+// attached to the same pool file and after reattaching it.
+int List_id(List* pList);
+
+// Returns the list in slot id, or NULL if no list is using that slot.
+List* List_from_id(int id);
+
+// Returns a ref to the first or last node of pList, or 0 if pList is empty.
+// Together with List_next_ref, List_prev_ref and List_ref_item these walk a list without
+// moving its current item. A ref stays valid while its item is in the list.
+NodeRef List_first_ref(List* pList);
+NodeRef List_last_ref(List* pList);
+
+// Returns a ref to the node after or before ref in pList, or 0 at the end or start.
+NodeRef List_next_ref(List* pList, NodeRef ref);
+NodeRef List_prev_ref(List* pList, NodeRef ref);
+
+// Returns a pointer to the item of the node ref in pList.
+void* List_ref_item(List* pList, NodeRef ref);
+
+// Returns a ref to the node an item of pList is stored in, which must be a list made by
+// List_create_inline and an item pointer handed out by a List_* function.
+NodeRef List_item_ref(List* pList, void* pItem);
+
+// Makes the node ref the current item of pList, or for ref 0 leaves the current pointer
+// beyond the end of pList, so List_add, List_insert and List_remove can work at any ref.
+void List_seek_ref(List* pList, NodeRef ref);
+
+// Public List_* operations, used to index per-operation counters.
+typedef enum {
+    LIST_OP_CREATE,
+    LIST_OP_COUNT,
+    LIST_OP_FREE_NODE_COUNT,
+    LIST_OP_FIRST,
+    LIST_OP_LAST,
+    LIST_OP_NEXT,
+    LIST_OP_PREV,
+    LIST_OP_CURR,
+    LIST_OP_ADD,
+    LIST_OP_INSERT,
+    LIST_OP_APPEND,
+    LIST_OP_PREPEND,
+    LIST_OP_APPEND_ALL,
+    LIST_OP_REMOVE,
+    LIST_OP_CONCAT,
+    LIST_OP_FREE,
+    LIST_OP_TRIM,
+    LIST_OP_SEARCH,
+    LIST_OP_SORT,
+    LIST_OP_MERGE,
+    LIST_OP_INSERT_SORTED,
+    LIST_OP_CREATE_INLINE,
+    LIST_OP_SAVE,
+    LIST_OP_LOAD,
+    LIST_OP_POOL_ATTACH,
+    LIST_OP_POOL_DETACH,
+    LIST_OP_ID,
+    LIST_OP_FROM_ID,
+    LIST_OP_FIRST_REF,
+    LIST_OP_LAST_REF,
+    LIST_OP_NEXT_REF,
+    LIST_OP_PREV_REF,
+    LIST_OP_REF_ITEM,
+    LIST_OP_POOL_MAP,
+    LIST_OP_POOL_PLACEMENT,
+    LIST_OP_RCU_SEARCH,
+    LIST_OP_RCU_SYNCHRONIZE,
+    LIST_OP_PUSH_BACK,
+    LIST_OP_PUSH_FRONT,
+    LIST_OP_POP_BACK,
+    LIST_OP_POP_FRONT,
+    LIST_OP_REMOVE_IF,
+    LIST_OP_ITEM_REF,
+    LIST_OP_SEEK_REF,
+    LIST_OP_SNAPSHOT,
+    LIST_OP_SNAPSHOT_IS_VALID,
+    LIST_OP_SNAPSHOT_RELEASE,
+    LIST_OP_CLONE,
+    LIST_OP_CLONE_RANGE,
+    LIST_OP_FREE_ASYNC,
+    LIST_OP_FREE_ASYNC_FLUSH,
+    LIST_OP_FREE_ASYNC_STOP,
+    LIST_NUM_OPS
+} ListOp;
+
+// Returns the name of the List_* function for op, such as "List_add".
+const char* List_op_name(ListOp op);
+
+// Lock-free readers, read-copy-update style.
+// Only compiled in when building with -DLIST_RCU.
+//
+// Threads that only read enter a read-side critical section with List_rcu_read_lock and
+// walk lists with List_rcu_search, List_first_ref and List_next_ref, taking no lock, while
+// one writer at a time (callers still serialize writers among themselves, or with
+// -DLIST_THREAD_SAFE only the writers of each list, e.g. with List_ts_*) changes them.
+// The writer publishes new links with release stores, so readers see every item fully
+// written, and a node taken out of a list is only recycled after a grace period, once
+// every reader that entered before it was taken out has left. Readers see each list
+// either before or after each change, but may miss items added while they walk it.
+//
+// List_add, List_insert, List_append, List_prepend, List_append_all, List_remove,
+// List_trim, the deque operations, List_remove_if, List_insert_sorted, List_free and
+// List_concat (for readers of pList1) are safe to run next to readers. List_sort,
+// List_merge and List_load relink nodes in place, so readers of the lists they change
+// must be kept out while they run. Items of lists not made by List_create_inline that
+// the writer frees must likewise only be freed after List_rcu_synchronize.
+#ifdef LIST_RCU
+// Maximum number of threads that have a reader slot at the same time
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_RCU_MAX_READERS
+#define LIST_RCU_MAX_READERS 64
+#endif
+
+// Number of nodes taken out of lists after which the writer starts a grace period for them
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_RCU_BATCH_SIZE
+#define LIST_RCU_BATCH_SIZE 32
+#endif
+
+// Enters a read-side critical section of the calling thread, which may be nested. Inside it
+// the thread may walk lists with List_rcu_search, List_first_ref and List_next_ref while
+// another thread changes them, and nodes it can reach are not recycled until it leaves.
+// The first call of a thread claims one of LIST_RCU_MAX_READERS reader slots.
+void List_rcu_read_lock();
+
+// Leaves the read-side critical section entered by the matching List_rcu_read_lock.
+// Items found inside it must not be used anymore.
+void List_rcu_read_unlock();
+
+// Gives the reader slot of the calling thread back, for threads that are about to exit.
+void List_rcu_thread_exit();
+
+// Searches pList from its first item for one that pComparator matches with pComparisonArg,
+// like List_search but without moving the current item, and returns it, or NULL if there
+// is none. Must be called inside a read-side critical section, and the item stays valid
+// until it is left.
+void* List_rcu_search(List* pList, COMPARATOR_FN pComparator, void* pComparisonArg);
+
+// Waits until every reader that may still be on a node taken out of a list has left its
+// read-side critical section, and recycles all such nodes. Must be called by the writer,
+// outside of a read-side critical section. The writer also recycles them on its own, in
+// batches of LIST_RCU_BATCH_SIZE and whenever the node pool runs out.
+void List_rcu_synchronize();
+#endif
+
+// Copy-on-write snapshots.
+// Only compiled in when building with -DLIST_SNAPSHOT, as every node grows by two refs.
+//
+// List_snapshot makes a read-only list showing pList as it is at that moment, in O(1) and
+// without copying a node. Changing pList afterwards leaves the snapshot as it was: the
+// first time a node a live snapshot can still see is changed, its old version is copied
+// into a spare node of the pool, which the snapshot reads instead. So snapshots cost one
+// node for each node changed while they live, which all go back to the pool when the last
+// snapshot is released.
+//
+// A snapshot is read with List_count, List_first, List_last, List_next, List_prev,
+// List_curr, List_search, List_save, List_clone, List_first_ref, List_next_ref, List_last_ref,
+// List_prev_ref and List_ref_item, using a current item of its own, and must not be
+// changed. Items of inline lists are copied with their node, items of other lists are
+// pointers, so the items themselves must not be freed while a snapshot may hand them out,
+// and inline items must not be written to through item pointers while a snapshot lives.
+//
+// Should the pool run out of nodes for old versions, every snapshot is emptied at once and
+// marked invalid, rather than failing the change to the list.
+#ifdef LIST_SNAPSHOT
+// Makes a read-only snapshot of pList, or of the snapshot pList, with a copy of its current
+// item. Returns it on success, or a NULL pointer if there is no head left for it.
+List* List_snapshot(List* pList);
+
+// Returns false if pSnapshot was emptied because the pool ran out of nodes for old versions.
+bool List_snapshot_is_valid(List* pSnapshot);
+
+// Gives the head of pSnapshot back, and with the last snapshot every old version.
+void List_snapshot_release(List* pSnapshot);
+#endif
+
+// Thread-safe wrappers with a lock for each list.
+// Only compiled in when building with -DLIST_THREAD_SAFE.
+//
+// Each List_ts_* function does what its List_* counterpart does while holding the lock
+// of every list it is given, so threads working on different lists never wait for each
+// other. The head pool and every partition of the node pool have a lock of their own,
+// only held while a head or node is taken out or given back, and free nodes are reserved
+// with an atomic count, so no lock covers the whole pool. List_create, List_create_inline
+// and List_free_node_count are safe to call from any thread as they are.
+//
+// Lists used by one thread only may keep using the plain List_* functions, but a list
+// shared between threads must only be used through List_ts_* functions, or between
+// List_ts_lock and List_ts_unlock. The current item is shared as well, so a walk with
+// List_next that must not see other threads' changes belongs between those two.
+// List_save, List_load, List_pool_attach, List_pool_map and List_pool_detach must not
+// run while other threads use lists. With -DLIST_RCU as well, writers of different
+// lists may run at the same time next to the readers.
+#ifdef LIST_THREAD_SAFE
+// Takes the lock of pList, waiting while another thread holds it.
+// Locks are not recursive: the List_ts_* functions must not be called on pList until
+// List_ts_unlock, the plain List_* functions are used instead.
+void List_ts_lock(List* pList);
+
+// Gives back the lock of pList taken by List_ts_lock.
+void List_ts_unlock(List* pList);
+
+// Like their List_* counterparts, holding the lock of pList.
+int List_ts_count(List* pList);
+void* List_ts_first(List* pList);
+void* List_ts_last(List* pList);
+void* List_ts_next(List* pList);
+void* List_ts_prev(List* pList);
+void* List_ts_curr(List* pList);
+int List_ts_add(List* pList, void* pItem);
+int List_ts_insert(List* pList, void* pItem);
+int List_ts_append(List* pList, void* pItem);
+int List_ts_prepend(List* pList, void* pItem);
+int List_ts_append_all(List* pList, void** pItems, int count);
+void* List_ts_remove(List* pList);
+void List_ts_free(List* pList, FREE_FN pItemFreeFn);
+void* List_ts_trim(List* pList);
+int List_ts_push_back(List* pList, void* pItem);
+int List_ts_push_front(List* pList, void* pItem);
+void* List_ts_pop_back(List* pList);
+void* List_ts_pop_front(List* pList);
+void* List_ts_search(List* pList, COMPARATOR_FN pComparator, void* pComparisonArg);
+int List_ts_remove_if(List* pList, COMPARATOR_FN pComparator, void* pComparisonArg, FREE_FN pItemFreeFn);
+List* List_ts_clone(List* pList);
+List* List_ts_clone_range(List* pList, NodeRef first, NodeRef last);
+void List_ts_sort(List* pList, ORDER_FN pOrder);
+int List_ts_insert_sorted(List* pList, void* pItem, ORDER_FN pOrder);
+
+// Like List_concat and List_merge, holding the locks of both lists. The locks are taken
+// in address order, so two threads concatenating the same two lists either way round
+// cannot deadlock.
+void List_ts_concat(List* pList1, List* pList2);
+void List_ts_merge(List* pDst, List* pSrc, ORDER_FN pOrder);
+#endif
+
+// Freeing lists on a background thread.
+// Only compiled in when building with -DLIST_ASYNC_FREE, which needs -DLIST_THREAD_SAFE.
+//
+// List_free_async takes the nodes of a list out of it and gives its head back in O(1), and
+// leaves calling pItemFreeFn on the items to a reclaimer thread, which gives the nodes
+// back to the pool in batches of LIST_ASYNC_BATCH_SIZE as it goes. The thread is started
+// by the first List_free_async. Until the reclaimer is done with a list, its nodes are not
+// available, and pItemFreeFn runs on the reclaimer thread, so it must be safe to call there.
+// List_load, List_pool_attach, List_pool_map and List_pool_detach wait for the reclaimer
+// to finish first.
+#ifdef LIST_ASYNC_FREE
+// Maximum number of freed lists waiting for the reclaimer, List_free_async waits for it
+// to catch up once that many are waiting
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_ASYNC_MAX_JOBS
+#define LIST_ASYNC_MAX_JOBS 64
+#endif
+
+// Number of nodes the reclaimer gives back to the pool at once
+// (You may modify its value for your needs, or define it when compiling)
+#ifndef LIST_ASYNC_BATCH_SIZE
+#define LIST_ASYNC_BATCH_SIZE 32
+#endif
+
+// Deletes pList like List_free, calling pItemFreeFn on its items on the reclaimer thread.
+// pList no longer exists after the operation and its head is available at once, its nodes
+// once the reclaimer is done with them. If the reclaimer thread cannot be started, pList
+// is freed on the calling thread.
+void List_free_async(List* pList, FREE_FN pItemFreeFn);
+
+// Like List_free_async, holding the lock of pList, see List_ts_lock.
+void List_ts_free_async(List* pList, FREE_FN pItemFreeFn);
+
+// Waits until the reclaimer is done with every list freed by List_free_async so far.
+void List_free_async_flush();
+
+// Waits like List_free_async_flush, then stops the reclaimer thread, e.g. before the
+// program exits. The next List_free_async starts it again.
+void List_free_async_stop();
+#endif
+
+// Pool occupancy statistics and operation counters.
+// Only compiled in when building with -DLIST_STATS, so they cost nothing otherwise.
+// Counters are updated with relaxed atomics.
+#ifdef LIST_STATS
+typedef struct ListStats_s ListStats;
+struct ListStats_s {
+    //nodes and heads currently taken out of the pools
+    int nodesInUse;
+    int headsInUse;
+    //most nodes and heads ever in use at the same time
+    int nodesHighWater;
+    int headsHighWater;
+    //List_add, List_insert, List_append, List_prepend, List_append_all and List_clone
+    //calls that failed because the node pool was empty
+    unsigned long long nodeFailures;
+    //List_create calls that failed because the head pool was empty
+    unsigned long long headFailures;
+    //number of calls to each List_* function
+    unsigned long long opCounts[LIST_NUM_OPS];
+};
+
+// Copies the current statistics into pStats.
+void List_stats_get(ListStats* pStats);
+
+// Clears the failure and operation counters, and lowers the high-water marks
+// to the current usage.
+void List_stats_reset();
+
+// Writes the statistics, including the length of every list in use, to pFile as
+// a single line JSON object. Returns 0 on success, -1 on a write error.
+int List_stats_dump_json(FILE* pFile);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
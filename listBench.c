@@ -0,0 +1,328 @@
+/**
+ * Benchmarks of the List_* functions.
+ * Built by "make bench" with -DLIST_THREAD_SAFE and a pool big enough for 32 threads.
+ *
+ * Usage: ./listBench threads [max threads] [operations per thread]
+ *        ./listBench heads [max threads] [operations per thread]
+ *        ./listBench deque [operations]
+ *
+ * threads: for 1, 2, 4, ... up to max threads it runs the same List_ts_* append and trim
+ * loop twice: once with a list for each thread, where only the node pool is shared,
+ * and once with all threads on one list.
+ *
+ * heads: for 1, 2, 4, ... up to max threads it gives every thread a list of its own, made
+ * one after another so their heads are neighbours in the head pool, and lets it walk the
+ * list with List_first and List_next, which write nothing but the head. Packed heads share
+ * cache lines, so the threads keep taking the lines from each other; build it once as is
+ * and once with DEFS=-DLIST_ALIGNED_HEADS to compare.
+ *
+ * deque: it uses a list as a queue and as a stack, once through List_append, List_trim,
+ * List_first and List_remove and once through the List_push_* and List_pop_* functions,
+ * and reports the instructions per operation, or nanoseconds where the kernel does not
+ * let us count instructions.
+ */
+
+#include "list.h"
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MAX_THREADS 32
+//items each thread keeps in the list while it runs
+#define BENCH_DEPTH 32
+
+typedef struct {
+    List *pList;
+    long numOps;
+    pthread_barrier_t *pStart;
+    //when the worker started and finished its loop
+    double begin;
+    double end;
+} Worker;
+
+static int s_item = 0;
+
+static double s_now(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void s_free_nothing(void *pItem){
+}
+
+static void *s_worker(void *pArg){
+    Worker *pWorker = pArg;
+    pthread_barrier_wait(pWorker->pStart);
+    pWorker->begin = s_now();
+    for(long i = 0; i < pWorker->numOps; i += 2 * BENCH_DEPTH){
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            if(List_ts_append(pWorker->pList, &s_item) != 0){
+                fprintf(stderr, "node pool ran out\n");
+                exit(1);
+            }
+        }
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            List_ts_trim(pWorker->pList);
+        }
+    }
+    pWorker->end = s_now();
+    return NULL;
+}
+
+//run numThreads workers, on one shared list or on a list each, and return the seconds taken
+static double s_run(int numThreads, long numOps, int isShared){
+    pthread_t threads[BENCH_MAX_THREADS];
+    Worker workers[BENCH_MAX_THREADS];
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, numThreads + 1);
+
+    List *pShared = isShared ? List_create() : NULL;
+    for(int i = 0; i < numThreads; ++i){
+        workers[i].pList = isShared ? pShared : List_create();
+        workers[i].numOps = numOps;
+        workers[i].pStart = &start;
+        if(workers[i].pList == NULL || pthread_create(threads + i, NULL, s_worker, workers + i) != 0){
+            fprintf(stderr, "cannot start thread %d\n", i);
+            exit(1);
+        }
+    }
+
+    pthread_barrier_wait(&start);
+    //from the first worker starting to the last one finishing
+    double begin = 0;
+    double end = 0;
+    for(int i = 0; i < numThreads; ++i){
+        pthread_join(threads[i], NULL);
+        if(i == 0 || workers[i].begin < begin){
+            begin = workers[i].begin;
+        }
+        if(workers[i].end > end){
+            end = workers[i].end;
+        }
+    }
+    double elapsed = end - begin;
+
+    for(int i = 0; i < numThreads; ++i){
+        if(!isShared || i == 0){
+            List_free(workers[i].pList, s_free_nothing);
+        }
+    }
+    pthread_barrier_destroy(&start);
+    return elapsed;
+}
+
+static void s_bench_threads(int maxThreads, long numOps){
+    printf("%-8s %-10s %12s %12s\n", "threads", "lists", "Mops/s", "ns/op");
+    for(int numThreads = 1; numThreads <= maxThreads; numThreads *= 2){
+        for(int isShared = 0; isShared <= 1; ++isShared){
+            double elapsed = s_run(numThreads, numOps, isShared);
+            double totalOps = (double)numThreads * numOps;
+            printf("%-8d %-10s %12.2f %12.1f\n", numThreads, isShared ? "shared" : "private",
+                   totalOps / elapsed / 1e6, elapsed * 1e9 * numThreads / totalOps);
+        }
+    }
+}
+
+static void *s_head_worker(void *pArg){
+    Worker *pWorker = pArg;
+    pthread_barrier_wait(pWorker->pStart);
+    pWorker->begin = s_now();
+    for(long i = 0; i < pWorker->numOps; ++i){
+        if(List_next(pWorker->pList) == NULL){
+            List_first(pWorker->pList);
+        }
+    }
+    pWorker->end = s_now();
+    return NULL;
+}
+
+//run numThreads cursor walkers on neighbouring heads, and return the seconds taken
+static double s_run_heads(int numThreads, long numOps){
+    pthread_t threads[BENCH_MAX_THREADS];
+    Worker workers[BENCH_MAX_THREADS];
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, numThreads + 1);
+
+    for(int i = 0; i < numThreads; ++i){
+        workers[i].pList = List_create();
+        workers[i].numOps = numOps;
+        workers[i].pStart = &start;
+        for(int j = 0; workers[i].pList != NULL && j < BENCH_DEPTH; ++j){
+            List_append(workers[i].pList, &s_item);
+        }
+    }
+    for(int i = 0; i < numThreads; ++i){
+        if(workers[i].pList == NULL || pthread_create(threads + i, NULL, s_head_worker, workers + i) != 0){
+            fprintf(stderr, "cannot start thread %d\n", i);
+            exit(1);
+        }
+    }
+
+    pthread_barrier_wait(&start);
+    double begin = 0;
+    double end = 0;
+    for(int i = 0; i < numThreads; ++i){
+        pthread_join(threads[i], NULL);
+        if(i == 0 || workers[i].begin < begin){
+            begin = workers[i].begin;
+        }
+        if(workers[i].end > end){
+            end = workers[i].end;
+        }
+    }
+
+    for(int i = 0; i < numThreads; ++i){
+        List_free(workers[i].pList, s_free_nothing);
+    }
+    pthread_barrier_destroy(&start);
+    return end - begin;
+}
+
+static void s_bench_heads(int maxThreads, long numOps){
+    printf("heads of %zu bytes, %s\n", sizeof(List),
+           _Alignof(List) >= LIST_CACHE_LINE_SIZE ? "one per cache line" : "packed");
+    printf("%-8s %12s %12s\n", "threads", "Mops/s", "ns/op");
+    for(int numThreads = 1; numThreads <= maxThreads; numThreads *= 2){
+        double elapsed = s_run_heads(numThreads, numOps);
+        double totalOps = (double)numThreads * numOps;
+        printf("%-8d %12.2f %12.1f\n", numThreads, totalOps / elapsed / 1e6, elapsed * 1e9 * numThreads / totalOps);
+    }
+}
+
+//a deque workload: fills a list BENCH_DEPTH items deep, then empties it again from one end
+typedef void (*DEQUE_FN)(List *pList, long numOps);
+
+static void s_queue_cursor(List *pList, long numOps){
+    for(long i = 0; i < numOps; i += 2 * BENCH_DEPTH){
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            List_append(pList, &s_item);
+        }
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            List_first(pList);
+            List_remove(pList);
+        }
+    }
+}
+
+static void s_queue_deque(List *pList, long numOps){
+    for(long i = 0; i < numOps; i += 2 * BENCH_DEPTH){
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            List_push_back(pList, &s_item);
+        }
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            List_pop_front(pList);
+        }
+    }
+}
+
+static void s_stack_cursor(List *pList, long numOps){
+    for(long i = 0; i < numOps; i += 2 * BENCH_DEPTH){
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            List_append(pList, &s_item);
+        }
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            List_trim(pList);
+        }
+    }
+}
+
+static void s_stack_deque(List *pList, long numOps){
+    for(long i = 0; i < numOps; i += 2 * BENCH_DEPTH){
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            List_push_back(pList, &s_item);
+        }
+        for(int j = 0; j < BENCH_DEPTH; ++j){
+            List_pop_back(pList);
+        }
+    }
+}
+
+//counter of the user space instructions of this thread, or -1 if perf events are not allowed
+static int s_open_instruction_counter(){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+//instructions, or nanoseconds without a counter, per operation of a deque workload
+static double s_measure(DEQUE_FN pDequeFn, long numOps, int counter){
+    List *pList = List_create();
+    //warm the pool up first
+    pDequeFn(pList, 2 * BENCH_DEPTH);
+
+    long long count = 0;
+    double begin = s_now();
+    if(counter >= 0){
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    pDequeFn(pList, numOps);
+    if(counter >= 0){
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(counter, &count, sizeof(count)) != sizeof(count)){
+            count = 0;
+        }
+    }
+    double elapsed = s_now() - begin;
+
+    List_free(pList, s_free_nothing);
+    return counter >= 0 ? (double)count / numOps : elapsed * 1e9 / numOps;
+}
+
+static void s_bench_deque(long numOps){
+    int counter = s_open_instruction_counter();
+    const char *unit = counter >= 0 ? "instr/op" : "ns/op";
+    printf("%-8s %14s %14s\n", "workload", "cursor", "deque");
+    printf("%-8s %14s %14s\n", "", unit, unit);
+    printf("%-8s %14.1f %14.1f\n", "queue",
+           s_measure(s_queue_cursor, numOps, counter), s_measure(s_queue_deque, numOps, counter));
+    printf("%-8s %14.1f %14.1f\n", "stack",
+           s_measure(s_stack_cursor, numOps, counter), s_measure(s_stack_deque, numOps, counter));
+    if(counter >= 0){
+        close(counter);
+    }
+}
+
+int main(int argCount, char *args[]){
+    const char *mode = argCount > 1 ? args[1] : "";
+    if(strcmp(mode, "threads") == 0){
+        int maxThreads = argCount > 2 ? atoi(args[2]) : 8;
+        long numOps = argCount > 3 ? atol(args[3]) : 2000000;
+        if(maxThreads >= 1 && maxThreads <= BENCH_MAX_THREADS && numOps >= 1){
+            s_bench_threads(maxThreads, numOps);
+            return 0;
+        }
+    }
+    else if(strcmp(mode, "heads") == 0){
+        int maxThreads = argCount > 2 ? atoi(args[2]) : 8;
+        long numOps = argCount > 3 ? atol(args[3]) : 20000000;
+        if(maxThreads >= 1 && maxThreads <= BENCH_MAX_THREADS && numOps >= 1){
+            s_bench_heads(maxThreads, numOps);
+            return 0;
+        }
+    }
+    else if(strcmp(mode, "deque") == 0){
+        long numOps = argCount > 2 ? atol(args[2]) : 10000000;
+        if(numOps >= 1){
+            s_bench_deque(numOps);
+            return 0;
+        }
+    }
+    fprintf(stderr, "usage: %s threads [max threads, 1 to %d] [operations per thread]\n", args[0], BENCH_MAX_THREADS);
+    fprintf(stderr, "       %s heads [max threads, 1 to %d] [operations per thread]\n", args[0], BENCH_MAX_THREADS);
+    fprintf(stderr, "       %s deque [operations]\n", args[0]);
+    return 1;
+}
@@ -0,0 +1,148 @@
+#ifdef LIST_RECORD
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "listRecord.h"
+
+//file being written, NULL while not recording
+static FILE *s_pFile = NULL;
+//serializes writes to s_pFile and starting and stopping
+static pthread_mutex_t s_recordLock = PTHREAD_MUTEX_INITIALIZER;
+//set when a call could not be written, reported by List_record_stop
+static bool s_hasFailed = false;
+
+//number of List_* calls the thread is inside of, only the outermost one is recorded
+static __thread int s_depth = 0;
+//tokens pushed for the call the thread records next
+static __thread uint64_t *s_pTokens = NULL;
+static __thread size_t s_numTokens = 0;
+static __thread size_t s_tokenCapacity = 0;
+
+//frees the token buffer of an exiting thread
+static pthread_key_t s_tokensKey;
+static pthread_once_t s_tokensKeyOnce = PTHREAD_ONCE_INIT;
+
+static void s_free_tokens(void *pTokens)
+{
+    free(pTokens);
+}
+
+static void s_make_tokens_key()
+{
+    pthread_key_create(&s_tokensKey, s_free_tokens);
+}
+
+// Starts writing the calls of all threads to pFile, after a ListRecordHeader.
+// Returns 0 on success, or -1 if a recording is already running or the header cannot be
+// written.
+int List_record_start(FILE *pFile)
+{
+    assert(pFile);
+    ListRecordHeader header = {LIST_RECORD_MAGIC, LIST_RECORD_VERSION, LIST_MAX_NUM_HEADS,
+                               LIST_MAX_NUM_NODES, LIST_INLINE_MAX_SIZE, sizeof(ListRecordEntry)};
+
+    pthread_mutex_lock(&s_recordLock);
+    int result = -1;
+    if (!s_pFile && fwrite(&header, sizeof(header), 1, pFile) == 1)
+    {
+        s_hasFailed = false;
+        __atomic_store_n(&s_pFile, pFile, __ATOMIC_RELEASE);
+        result = 0;
+    }
+    pthread_mutex_unlock(&s_recordLock);
+    return result;
+}
+
+// Stops the recording and flushes pFile, which the caller closes.
+// Returns 0 on success, or -1 if there was no recording or a call could not be written.
+int List_record_stop()
+{
+    pthread_mutex_lock(&s_recordLock);
+    FILE *pFile = s_pFile;
+    __atomic_store_n(&s_pFile, NULL, __ATOMIC_RELEASE);
+    int result = pFile && !s_hasFailed && fflush(pFile) == 0 ? 0 : -1;
+    pthread_mutex_unlock(&s_recordLock);
+    return result;
+}
+
+// Hooks used by list.c to record a call, not meant to be called directly.
+ListRecordScope List_record_begin()
+{
+    ListRecordScope scope = {++s_depth};
+    return scope;
+}
+
+void List_record_end(ListRecordScope *pScope)
+{
+    assert(pScope->depth == s_depth);
+    if (--s_depth == 0)
+    {
+        //a call that pushed tokens but was not recorded must not leave them to the next one
+        s_numTokens = 0;
+    }
+}
+
+uint64_t List_record_token(List *pList, const void *pItem)
+{
+    uint64_t token = 0;
+    if (pItem && pList && pList->itemSize)
+    {
+        memcpy(&token, pItem, pList->itemSize < sizeof(token) ? pList->itemSize : sizeof(token));
+    }
+    else
+    {
+        token = (uintptr_t)pItem;
+    }
+    return token;
+}
+
+void List_record_push(uint64_t token)
+{
+    if (s_depth != 1 || !__atomic_load_n(&s_pFile, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    if (s_numTokens == s_tokenCapacity)
+    {
+        size_t capacity = s_tokenCapacity ? s_tokenCapacity * 2 : 64;
+        uint64_t *pTokens = realloc(s_pTokens, capacity * sizeof(uint64_t));
+        if (!pTokens)
+        {
+            __atomic_store_n(&s_hasFailed, true, __ATOMIC_RELAXED);
+            return;
+        }
+        if (!s_pTokens)
+        {
+            pthread_once(&s_tokensKeyOnce, s_make_tokens_key);
+        }
+        pthread_setspecific(s_tokensKey, pTokens);
+        s_pTokens = pTokens;
+        s_tokenCapacity = capacity;
+    }
+    s_pTokens[s_numTokens++] = token;
+}
+
+void List_record_call(ListOp op, uint32_t list, uint32_t other, uint64_t token)
+{
+    if (s_depth != 1 || !__atomic_load_n(&s_pFile, __ATOMIC_ACQUIRE))
+    {
+        s_numTokens = 0;
+        return;
+    }
+    ListRecordEntry entry = {token, op, list, other, s_numTokens};
+
+    pthread_mutex_lock(&s_recordLock);
+    //the recording may have stopped since the check above, and a call without tokens
+    //may have no token buffer at all
+    if (s_pFile &&
+        (fwrite(&entry, sizeof(entry), 1, s_pFile) != 1 ||
+         (s_numTokens && fwrite(s_pTokens, sizeof(uint64_t), s_numTokens, s_pFile) != s_numTokens)))
+    {
+        s_hasFailed = true;
+    }
+    pthread_mutex_unlock(&s_recordLock);
+    s_numTokens = 0;
+}
+
+#endif
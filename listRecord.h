@@ -0,0 +1,78 @@
+// Recording of List_* calls, to replay real workloads with listReplay.
+// Only compiled in when building with -DLIST_RECORD; without it the hooks in list.c
+// expand to nothing and none of these functions exist. The file format below is always
+// there, so listReplay can read recordings without recording itself.
+//
+// Between List_record_start and List_record_stop every List_* call that changes a list or
+// moves its current item, and List_create, List_search and List_clone, is written to a
+// file as a ListRecordEntry, in the order the calls are made. Lists are recorded by their
+// slot, see List_id, and items by a token. Calls made from inside comparators, order and
+// free routines belong to the call that made them and are not written. The ref functions,
+// List_clone_range, snapshots, List_save, List_load and the pool functions are not
+// recorded either.
+//
+// A token stands for an item without the item itself: the item pointer for lists of
+// pointers, the first 8 bytes of the item for inline lists, and 0 for NULL.
+
+#ifndef _LIST_RECORD_H_
+#define _LIST_RECORD_H_
+#include <stdint.h>
+#include <stdio.h>
+#include "list.h"
+
+// First word of a recording, and its format version
+#define LIST_RECORD_MAGIC 0x52534c44u
+#define LIST_RECORD_VERSION 1u
+// List slot of a call that has no list, such as a List_create that failed
+#define LIST_RECORD_NO_LIST 0xffffffffu
+
+// Start of a recording, with the pool sizes it was made with.
+typedef struct ListRecordHeader_s ListRecordHeader;
+struct ListRecordHeader_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numHeads;
+    uint32_t numNodes;
+    uint32_t inlineMaxSize;
+    uint32_t entrySize;
+};
+
+// One recorded call, followed in the file by count tokens.
+//
+// list is the slot of the list the call works on, or the list List_create made. other is
+// the slot of the second list of List_concat and List_merge, or of the list List_clone
+// made, and the item size of List_create_inline. token is the item given to the call, or
+// the item List_search found. The tokens that follow are the items of List_append_all,
+// or those List_remove_if took out.
+typedef struct ListRecordEntry_s ListRecordEntry;
+struct ListRecordEntry_s {
+    uint64_t token;
+    uint32_t op;
+    uint32_t list;
+    uint32_t other;
+    uint32_t count;
+};
+
+#ifdef LIST_RECORD
+// Starts writing the calls of all threads to pFile, after a ListRecordHeader.
+// Returns 0 on success, or -1 if a recording is already running or the header cannot be
+// written.
+int List_record_start(FILE* pFile);
+
+// Stops the recording and flushes pFile, which the caller closes.
+// Returns 0 on success, or -1 if there was no recording or a call could not be written.
+int List_record_stop();
+
+// Hooks used by list.c to record a call, not meant to be called directly.
+typedef struct ListRecordScope_s ListRecordScope;
+struct ListRecordScope_s {
+    int depth;
+};
+ListRecordScope List_record_begin();
+void List_record_end(ListRecordScope* pScope);
+uint64_t List_record_token(List* pList, const void* pItem);
+void List_record_push(uint64_t token);
+void List_record_call(ListOp op, uint32_t list, uint32_t other, uint64_t token);
+
+#endif
+#endif
@@ -0,0 +1,323 @@
+/**
+ * Replays a recording made with -DLIST_RECORD against list.c, and times every call.
+ * Built by "make replay", with the same pool sizes the recording was made with, e.g.
+ * "make replay DEFS='-DLIST_MAX_NUM_NODES=4096'".
+ *
+ * Usage: ./listReplay recording [repeats]
+ *
+ * The calls are made one after another on one thread, in the order they were recorded,
+ * repeats times over (1 by default), with the lists freed in between. For every List_*
+ * function it reports the calls and the nanoseconds per call, clock reads included, and
+ * it counts the calls whose result differs from the recorded one, which happens if the
+ * pools are smaller than when recording.
+ *
+ * Items are the tokens of the recording: pointers that are never read for lists of
+ * pointers, the recorded bytes for inline lists. The comparators and orders of the
+ * recorded program are not known, so stand-ins take their place: List_search matches the
+ * recorded token, List_remove_if takes out the items with a recorded token, and
+ * List_sort, List_merge and List_insert_sorted order by token. The lists go through the
+ * same calls, but the items these move around can differ from the recorded program.
+ *
+ * For profile guided optimization, build with DEFS=-fprofile-generate and replay a
+ * recording of the real program. The profile of list.c is then in listReplay-list.gcda,
+ * for compiling list.c with -fprofile-use and the other flags of "make replay" once
+ * renamed to list.gcda.
+ */
+
+#include "list.h"
+#include "listRecord.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//a recorded call and its tokens
+typedef struct {
+    ListRecordEntry entry;
+    uint64_t *pTokens;
+    //room for the items of List_append_all
+    void **ppItems;
+} Call;
+
+//item size of the list being called, read by the stand-in comparators and orders
+static size_t s_itemSize = 0;
+
+static double s_now(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void s_free_nothing(void *pItem){
+}
+
+//token of an item in a list of s_itemSize items
+static uint64_t s_token(void *pItem){
+    uint64_t token = 0;
+    if(s_itemSize){
+        memcpy(&token, pItem, s_itemSize < sizeof(token) ? s_itemSize : sizeof(token));
+    }else{
+        token = (uintptr_t)pItem;
+    }
+    return token;
+}
+
+static int s_compare_tokens(const void *pToken1, const void *pToken2){
+    uint64_t token1 = *(const uint64_t *)pToken1;
+    uint64_t token2 = *(const uint64_t *)pToken2;
+    return token1 < token2 ? -1 : token1 > token2;
+}
+
+//stand-in for the List_search comparator, pArg is the recorded token
+static bool s_match(void *pItem, void *pArg){
+    return s_token(pItem) == *(uint64_t *)pArg;
+}
+
+//stand-in for the List_remove_if comparator, pArg is the sorted recorded tokens
+static bool s_match_any(void *pItem, void *pArg){
+    Call *pCall = pArg;
+    uint64_t token = s_token(pItem);
+    return bsearch(&token, pCall->pTokens, pCall->entry.count, sizeof(uint64_t), s_compare_tokens) != NULL;
+}
+
+//stand-in for the orders
+static int s_order(void *pItem1, void *pItem2){
+    uint64_t token1 = s_token(pItem1);
+    uint64_t token2 = s_token(pItem2);
+    return s_compare_tokens(&token1, &token2);
+}
+
+//reads the whole recording, returns the number of calls or -1
+static long s_read(FILE *pFile, ListRecordHeader *pHeader, Call **ppCalls){
+    if(fread(pHeader, sizeof(*pHeader), 1, pFile) != 1 || pHeader->magic != LIST_RECORD_MAGIC ||
+       pHeader->version != LIST_RECORD_VERSION || pHeader->entrySize != sizeof(ListRecordEntry)){
+        return -1;
+    }
+    long numCalls = 0;
+    long capacity = 0;
+    Call *pCalls = NULL;
+    ListRecordEntry entry;
+    while(fread(&entry, sizeof(entry), 1, pFile) == 1){
+        if(entry.op >= LIST_NUM_OPS){
+            break;
+        }
+        if(numCalls == capacity){
+            long newCapacity = capacity ? capacity * 2 : 1024;
+            Call *pNewCalls = realloc(pCalls, newCapacity * sizeof(Call));
+            if(!pNewCalls){
+                break;
+            }
+            pCalls = pNewCalls;
+            capacity = newCapacity;
+        }
+        Call *pCall = pCalls + numCalls;
+        pCall->entry = entry;
+        //room for reading a whole inline item from the last token
+        pCall->pTokens = malloc((entry.count + LIST_INLINE_MAX_SIZE / sizeof(uint64_t) + 1) * sizeof(uint64_t));
+        pCall->ppItems = entry.op == LIST_OP_APPEND_ALL ? malloc((entry.count + 1) * sizeof(void *)) : NULL;
+        //a call that cannot be held or read whole is left out, with the ones after it
+        if(!pCall->pTokens || (entry.op == LIST_OP_APPEND_ALL && !pCall->ppItems) ||
+           fread(pCall->pTokens, sizeof(uint64_t), entry.count, pFile) != entry.count){
+            free(pCall->pTokens);
+            free(pCall->ppItems);
+            break;
+        }
+        ++numCalls;
+        //List_remove_if looks its items up
+        if(entry.op == LIST_OP_REMOVE_IF){
+            qsort(pCall->pTokens, entry.count, sizeof(uint64_t), s_compare_tokens);
+        }
+    }
+    if(!feof(pFile)){
+        fprintf(stderr, "recording is cut short after %ld calls\n", numCalls);
+    }
+    *ppCalls = pCalls;
+    return numCalls;
+}
+
+//makes one call, returns whether its result is the recorded one
+static bool s_call(Call *pCall, List **ppLists, uint32_t numLists){
+    ListRecordEntry *pEntry = &pCall->entry;
+    List *pList = pEntry->list < numLists ? ppLists[pEntry->list] : NULL;
+    List *pOther = pEntry->other < numLists ? ppLists[pEntry->other] : NULL;
+    s_itemSize = pList ? pList->itemSize : 0;
+    //the item as the list takes it, a pointer or the recorded bytes
+    unsigned char value[LIST_INLINE_MAX_SIZE > sizeof(uint64_t) ? LIST_INLINE_MAX_SIZE : sizeof(uint64_t)] = {0};
+    memcpy(value, &pEntry->token, sizeof(uint64_t));
+    void *pItem = s_itemSize ? (void *)value : (void *)(uintptr_t)pEntry->token;
+
+    switch(pEntry->op){
+    case LIST_OP_CREATE:
+    case LIST_OP_CREATE_INLINE:
+    case LIST_OP_CLONE:{
+        List *pNew = pEntry->op == LIST_OP_CREATE ? List_create() :
+                     pEntry->op == LIST_OP_CREATE_INLINE ? List_create_inline(pEntry->other) :
+                     List_clone(pList);
+        uint32_t slot = pEntry->op == LIST_OP_CLONE ? pEntry->other : pEntry->list;
+        if(slot < numLists){
+            ppLists[slot] = pNew;
+        }
+        return (pNew != NULL) == (slot != LIST_RECORD_NO_LIST);
+    }
+    case LIST_OP_COUNT: List_count(pList); break;
+    case LIST_OP_FIRST: List_first(pList); break;
+    case LIST_OP_LAST: List_last(pList); break;
+    case LIST_OP_NEXT: List_next(pList); break;
+    case LIST_OP_PREV: List_prev(pList); break;
+    case LIST_OP_CURR: List_curr(pList); break;
+    case LIST_OP_ADD: return List_add(pList, pItem) == 0;
+    case LIST_OP_INSERT: return List_insert(pList, pItem) == 0;
+    case LIST_OP_APPEND: return List_append(pList, pItem) == 0;
+    case LIST_OP_PREPEND: return List_prepend(pList, pItem) == 0;
+    case LIST_OP_PUSH_BACK: return List_push_back(pList, pItem) == 0;
+    case LIST_OP_PUSH_FRONT: return List_push_front(pList, pItem) == 0;
+    case LIST_OP_INSERT_SORTED: return List_insert_sorted(pList, pItem, s_order) == 0;
+    case LIST_OP_APPEND_ALL:{
+        //inline items are read through pointers to them
+        for(uint32_t i = 0; i < pEntry->count; ++i){
+            pCall->ppItems[i] = s_itemSize ? (void *)(pCall->pTokens + i) : (void *)(uintptr_t)pCall->pTokens[i];
+        }
+        return List_append_all(pList, pCall->ppItems, pEntry->count) == 0;
+    }
+    case LIST_OP_REMOVE: List_remove(pList); break;
+    case LIST_OP_TRIM: List_trim(pList); break;
+    case LIST_OP_POP_BACK: List_pop_back(pList); break;
+    case LIST_OP_POP_FRONT: List_pop_front(pList); break;
+    case LIST_OP_SEARCH:{
+        void *pFound = List_search(pList, s_match, &pEntry->token);
+        return pEntry->token ? pFound && s_token(pFound) == pEntry->token : !pFound;
+    }
+    case LIST_OP_REMOVE_IF:
+        return List_remove_if(pList, s_match_any, pCall, NULL) == (int)pEntry->count;
+    case LIST_OP_SORT: List_sort(pList, s_order); break;
+    case LIST_OP_CONCAT:
+        List_concat(pList, pOther);
+        ppLists[pEntry->other] = NULL;
+        break;
+    case LIST_OP_MERGE:
+        List_merge(pList, pOther, s_order);
+        ppLists[pEntry->other] = NULL;
+        break;
+    case LIST_OP_FREE_ASYNC:
+#ifdef LIST_ASYNC_FREE
+        List_free_async(pList, s_free_nothing);
+        ppLists[pEntry->list] = NULL;
+        break;
+#endif
+        //without the reclaimer it is a List_free
+    case LIST_OP_FREE:
+        List_free(pList, s_free_nothing);
+        ppLists[pEntry->list] = NULL;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+//whether the lists a call needs are there
+static bool s_can_call(Call *pCall, List **ppLists, uint32_t numLists){
+    ListRecordEntry *pEntry = &pCall->entry;
+    switch(pEntry->op){
+    case LIST_OP_CREATE:
+    case LIST_OP_CREATE_INLINE:
+        return pEntry->list >= numLists || !ppLists[pEntry->list];
+    case LIST_OP_CONCAT:
+    case LIST_OP_MERGE:
+        if(pEntry->other >= numLists || !ppLists[pEntry->other]){
+            return false;
+        }
+        break;
+    case LIST_OP_CLONE:
+        if(pEntry->other < numLists && ppLists[pEntry->other]){
+            return false;
+        }
+        break;
+    default:
+        break;
+    }
+    return pEntry->list < numLists && ppLists[pEntry->list];
+}
+
+int main(int argCount, char *args[]){
+    if(argCount < 2){
+        fprintf(stderr, "usage: %s recording [repeats]\n", args[0]);
+        return 1;
+    }
+    int repeats = argCount > 2 ? atoi(args[2]) : 1;
+    FILE *pFile = fopen(args[1], "rb");
+    if(!pFile){
+        perror(args[1]);
+        return 1;
+    }
+    ListRecordHeader header;
+    Call *pCalls = NULL;
+    long numCalls = s_read(pFile, &header, &pCalls);
+    fclose(pFile);
+    if(numCalls < 0){
+        fprintf(stderr, "%s is not a recording of this version\n", args[1]);
+        return 1;
+    }
+    if(header.numHeads != LIST_MAX_NUM_HEADS || header.numNodes != LIST_MAX_NUM_NODES ||
+       header.inlineMaxSize != LIST_INLINE_MAX_SIZE){
+        fprintf(stderr, "warning: recorded with %u heads, %u nodes and %u byte inline items, "
+                "replaying with %d, %d and %d\n", header.numHeads, header.numNodes, header.inlineMaxSize,
+                LIST_MAX_NUM_HEADS, LIST_MAX_NUM_NODES, (int)LIST_INLINE_MAX_SIZE);
+    }
+
+    List **ppLists = calloc(header.numHeads, sizeof(List *));
+    if(!ppLists && header.numHeads){
+        fprintf(stderr, "out of memory for %u lists\n", header.numHeads);
+        return 1;
+    }
+    long counts[LIST_NUM_OPS] = {0};
+    double seconds[LIST_NUM_OPS] = {0};
+    long numMismatches = 0;
+    long numSkipped = 0;
+    double total = 0;
+    for(int repeat = 0; repeat < repeats; ++repeat){
+        for(long i = 0; i < numCalls; ++i){
+            Call *pCall = pCalls + i;
+            //calls on lists this replay could not make are left out
+            if(!s_can_call(pCall, ppLists, header.numHeads)){
+                ++numSkipped;
+                continue;
+            }
+            double begin = s_now();
+            bool isSame = s_call(pCall, ppLists, header.numHeads);
+            double elapsed = s_now() - begin;
+            numMismatches += !isSame;
+            ++counts[pCall->entry.op];
+            seconds[pCall->entry.op] += elapsed;
+            total += elapsed;
+        }
+        //start the next round from empty pools
+        for(uint32_t i = 0; i < header.numHeads; ++i){
+            if(ppLists[i]){
+                List_free(ppLists[i], s_free_nothing);
+                ppLists[i] = NULL;
+            }
+        }
+#ifdef LIST_ASYNC_FREE
+        List_free_async_flush();
+#endif
+    }
+
+    printf("%ld calls, %d repeats\n", numCalls, repeats);
+    printf("%-24s %12s %12s\n", "function", "calls", "ns/call");
+    for(int op = 0; op < LIST_NUM_OPS; ++op){
+        if(counts[op]){
+            printf("%-24s %12ld %12.1f\n", List_op_name(op), counts[op], seconds[op] * 1e9 / counts[op]);
+        }
+    }
+    printf("total %.3f ms, %ld results differ from the recording, %ld calls skipped\n",
+           total * 1e3, numMismatches, numSkipped);
+
+    for(long i = 0; i < numCalls; ++i){
+        free(pCalls[i].pTokens);
+        free(pCalls[i].ppItems);
+    }
+    free(pCalls);
+    free(ppLists);
+    return 0;
+}
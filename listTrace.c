@@ -0,0 +1,242 @@
+#ifdef LIST_TRACE
+#include <assert.h>
+#include <stddef.h>
+#include <time.h>
+#include "listTrace.h"
+#if defined(LIST_TRACE_TSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+//latency histogram of one operation, all updates are relaxed atomics
+typedef struct Histogram_s Histogram;
+struct Histogram_s {
+    uint64_t count;
+    uint64_t total;
+    //stored inverted so that the zero initial value means no minimum yet
+    uint64_t minInverted;
+    uint64_t max;
+    uint64_t buckets[LIST_TRACE_NUM_BUCKETS];
+};
+
+//one histogram per operation
+static Histogram s_histograms[LIST_NUM_OPS];
+//most recent calls, s_ringNext counts every call ever written
+static ListTraceEvent s_ring[LIST_TRACE_RING_SIZE];
+static uint64_t s_ringNext = 0;
+//user callback invoked after every call
+static LIST_TRACE_FN s_pCallback = NULL;
+static void *s_pCallbackContext = NULL;
+//set while the thread runs the callback, whose own List_* calls do not call it again
+static __thread bool s_isInCallback = false;
+
+//current time stamp
+static uint64_t s_now()
+{
+#if defined(LIST_TRACE_TSC) && (defined(__x86_64__) || defined(__i386__))
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+#endif
+}
+
+//histogram bucket of a value, exact below 16
+//then 8 buckets for every power of 2
+static size_t s_bucket(uint64_t value)
+{
+    if (value < 16)
+    {
+        return value;
+    }
+    size_t exponent = 63 - __builtin_clzll(value);
+    //the 3 bits right below the leading bit pick the sub bucket
+    return 16 + (exponent - 4) * 8 + ((value >> (exponent - 3)) & 7);
+}
+
+//largest value that falls into a bucket
+static uint64_t s_bucket_max(size_t bucket)
+{
+    if (bucket < 16)
+    {
+        return bucket;
+    }
+    size_t exponent = (bucket - 16) / 8 + 4;
+    uint64_t width = (uint64_t)1 << (exponent - 3);
+    return (8 + (bucket - 16) % 8) * width + width - 1;
+}
+
+//raise *pMax to value if it is larger
+static void s_atomic_max(uint64_t *pMax, uint64_t value)
+{
+    uint64_t max = __atomic_load_n(pMax, __ATOMIC_RELAXED);
+    while (value > max &&
+           !__atomic_compare_exchange_n(pMax, &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+// Hooks used by list.c to time a call, not meant to be called directly.
+ListTraceScope List_trace_begin(ListOp op)
+{
+    ListTraceScope scope = {op, s_now()};
+    return scope;
+}
+
+void List_trace_end(ListTraceScope *pScope)
+{
+    ListTraceEvent event = {pScope->op, pScope->start, s_now() - pScope->start};
+
+    //record into the histogram of the operation
+    Histogram *pHistogram = s_histograms + event.op;
+    __atomic_fetch_add(&pHistogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pHistogram->total, event.elapsed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pHistogram->buckets[s_bucket(event.elapsed)], 1, __ATOMIC_RELAXED);
+    s_atomic_max(&pHistogram->minInverted, ~event.elapsed);
+    s_atomic_max(&pHistogram->max, event.elapsed);
+
+    //overwrite the oldest slot of the ring buffer
+    uint64_t slot = __atomic_fetch_add(&s_ringNext, 1, __ATOMIC_RELAXED);
+    s_ring[slot & (LIST_TRACE_RING_SIZE - 1)] = event;
+
+    LIST_TRACE_FN pCallback = __atomic_load_n(&s_pCallback, __ATOMIC_ACQUIRE);
+    if (pCallback && !s_isInCallback)
+    {
+        s_isInCallback = true;
+        (*pCallback)(&event, s_pCallbackContext);
+        s_isInCallback = false;
+    }
+}
+
+// Registers pCallback to be invoked after every traced call, replacing any
+// previous callback. Pass NULL to remove it.
+void List_trace_set_callback(LIST_TRACE_FN pCallback, void *pContext)
+{
+    s_pCallbackContext = pContext;
+    __atomic_store_n(&s_pCallback, pCallback, __ATOMIC_RELEASE);
+}
+
+// Returns the time at or below which the given fraction (0 to 1) of op's calls
+// completed, within the 12.5% histogram precision. Returns 0 if op has no calls.
+uint64_t List_trace_percentile(ListOp op, double fraction)
+{
+    assert(op >= 0 && op < LIST_NUM_OPS);
+    assert(fraction >= 0 && fraction <= 1);
+    Histogram *pHistogram = s_histograms + op;
+
+    uint64_t count = __atomic_load_n(&pHistogram->count, __ATOMIC_RELAXED);
+    if (!count)
+    {
+        return 0;
+    }
+    //rank of the call we are looking for, at least the first one
+    uint64_t rank = (uint64_t)(fraction * count + 0.999999);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    uint64_t max = __atomic_load_n(&pHistogram->max, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < LIST_TRACE_NUM_BUCKETS; ++i)
+    {
+        seen += __atomic_load_n(&pHistogram->buckets[i], __ATOMIC_RELAXED);
+        if (seen >= rank)
+        {
+            //the bucket bound can be above anything actually seen
+            uint64_t value = s_bucket_max(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+// Fills pSummary with op's call count, min, max, total and common percentiles.
+void List_trace_summary(ListOp op, ListTraceSummary *pSummary)
+{
+    assert(op >= 0 && op < LIST_NUM_OPS);
+    assert(pSummary != NULL);
+    Histogram *pHistogram = s_histograms + op;
+
+    pSummary->count = __atomic_load_n(&pHistogram->count, __ATOMIC_RELAXED);
+    pSummary->total = __atomic_load_n(&pHistogram->total, __ATOMIC_RELAXED);
+    pSummary->min = pSummary->count ? ~__atomic_load_n(&pHistogram->minInverted, __ATOMIC_RELAXED) : 0;
+    pSummary->max = __atomic_load_n(&pHistogram->max, __ATOMIC_RELAXED);
+    pSummary->p50 = List_trace_percentile(op, 0.5);
+    pSummary->p90 = List_trace_percentile(op, 0.9);
+    pSummary->p99 = List_trace_percentile(op, 0.99);
+    pSummary->p999 = List_trace_percentile(op, 0.999);
+}
+
+// Copies up to maxEvents of the most recent calls into pEvents, oldest first,
+// and returns how many were copied.
+int List_trace_recent(ListTraceEvent *pEvents, int maxEvents)
+{
+    assert(pEvents != NULL && maxEvents >= 0);
+    uint64_t next = __atomic_load_n(&s_ringNext, __ATOMIC_RELAXED);
+
+    //the ring only holds the last LIST_TRACE_RING_SIZE calls
+    uint64_t count = next < LIST_TRACE_RING_SIZE ? next : LIST_TRACE_RING_SIZE;
+    if (count > (uint64_t)maxEvents)
+    {
+        count = maxEvents;
+    }
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        pEvents[i] = s_ring[(next - count + i) & (LIST_TRACE_RING_SIZE - 1)];
+    }
+    return count;
+}
+
+// Writes a summary line for each operation that was called, followed by the
+// ring buffer contents, to pFile. Returns 0 on success, -1 on a write error.
+int List_trace_dump(FILE *pFile)
+{
+    assert(pFile != NULL);
+
+    for (int op = 0; op < LIST_NUM_OPS; ++op)
+    {
+        ListTraceSummary summary;
+        List_trace_summary(op, &summary);
+        if (summary.count)
+        {
+            fprintf(pFile, "%s count=%llu min=%llu p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu total=%llu\n",
+                    List_op_name(op), (unsigned long long)summary.count,
+                    (unsigned long long)summary.min, (unsigned long long)summary.p50,
+                    (unsigned long long)summary.p90, (unsigned long long)summary.p99,
+                    (unsigned long long)summary.p999, (unsigned long long)summary.max,
+                    (unsigned long long)summary.total);
+        }
+    }
+
+    //walk the ring oldest first, it only holds the last LIST_TRACE_RING_SIZE calls
+    uint64_t next = __atomic_load_n(&s_ringNext, __ATOMIC_RELAXED);
+    uint64_t count = next < LIST_TRACE_RING_SIZE ? next : LIST_TRACE_RING_SIZE;
+    for (uint64_t i = next - count; i < next; ++i)
+    {
+        ListTraceEvent *pEvent = s_ring + (i & (LIST_TRACE_RING_SIZE - 1));
+        fprintf(pFile, "recent %s start=%llu elapsed=%llu\n", List_op_name(pEvent->op),
+                (unsigned long long)pEvent->start, (unsigned long long)pEvent->elapsed);
+    }
+
+    return ferror(pFile) ? -1 : 0;
+}
+
+// Clears all histograms and the ring buffer.
+void List_trace_reset()
+{
+    for (size_t op = 0; op < LIST_NUM_OPS; ++op)
+    {
+        Histogram *pHistogram = s_histograms + op;
+        __atomic_store_n(&pHistogram->count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&pHistogram->total, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&pHistogram->minInverted, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&pHistogram->max, 0, __ATOMIC_RELAXED);
+        for (size_t i = 0; i < LIST_TRACE_NUM_BUCKETS; ++i)
+        {
+            __atomic_store_n(&pHistogram->buckets[i], 0, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&s_ringNext, 0, __ATOMIC_RELAXED);
+}
+#endif
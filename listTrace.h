@@ -0,0 +1,86 @@
+// Latency tracing for the List_* functions.
+// Only compiled in when building with -DLIST_TRACE; without it the hooks in list.c
+// expand to nothing and none of these functions exist.
+//
+// Every public List_* call is timed from entry to return. Timings go into a
+// per-operation log-linear histogram, a ring buffer of the most recent calls, and
+// an optional user callback. Times are nanoseconds from CLOCK_MONOTONIC, or raw
+// time stamp counter ticks when also building with -DLIST_TRACE_TSC on x86.
+
+#ifndef _LIST_TRACE_H_
+#define _LIST_TRACE_H_
+#ifdef LIST_TRACE
+#include <stdint.h>
+#include <stdio.h>
+#include "list.h"
+
+// Number of most recent calls kept in the ring buffer, must be a power of 2
+#ifndef LIST_TRACE_RING_SIZE
+#define LIST_TRACE_RING_SIZE 1024
+#endif
+
+// Histogram buckets: values below 16 get one bucket each, larger values get
+// 8 buckets per power of 2, so a bucket is within 12.5% of any value in it.
+#define LIST_TRACE_NUM_BUCKETS (16 + 60 * 8)
+
+// One traced call.
+typedef struct ListTraceEvent_s ListTraceEvent;
+struct ListTraceEvent_s {
+    ListOp op;
+    //time stamp at entry
+    uint64_t start;
+    //time spent until return
+    uint64_t elapsed;
+};
+
+// Latency summary of one operation.
+typedef struct ListTraceSummary_s ListTraceSummary;
+struct ListTraceSummary_s {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t total;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+};
+
+// Called after every traced call, on the calling thread.
+// The callback may call List_* functions; those calls are traced as well, but do not
+// invoke the callback again.
+typedef void (*LIST_TRACE_FN)(const ListTraceEvent* pEvent, void* pContext);
+
+// Registers pCallback to be invoked after every traced call, replacing any
+// previous callback. Pass NULL to remove it.
+void List_trace_set_callback(LIST_TRACE_FN pCallback, void* pContext);
+
+// Returns the time at or below which the given fraction (0 to 1) of op's calls
+// completed, within the 12.5% histogram precision. Returns 0 if op has no calls.
+uint64_t List_trace_percentile(ListOp op, double fraction);
+
+// Fills pSummary with op's call count, min, max, total and common percentiles.
+void List_trace_summary(ListOp op, ListTraceSummary* pSummary);
+
+// Copies up to maxEvents of the most recent calls into pEvents, oldest first,
+// and returns how many were copied.
+int List_trace_recent(ListTraceEvent* pEvents, int maxEvents);
+
+// Writes a summary line for each operation that was called, followed by the
+// ring buffer contents, to pFile. Returns 0 on success, -1 on a write error.
+int List_trace_dump(FILE* pFile);
+
+// Clears all histograms and the ring buffer.
+void List_trace_reset();
+
+// Hooks used by list.c to time a call, not meant to be called directly.
+typedef struct ListTraceScope_s ListTraceScope;
+struct ListTraceScope_s {
+    ListOp op;
+    uint64_t start;
+};
+ListTraceScope List_trace_begin(ListOp op);
+void List_trace_end(ListTraceScope* pScope);
+
+#endif
+#endif
@@ -4,10 +4,19 @@
  */
 
 #include "list.h"
+#include "listRecord.h"
+#include "listTrace.h"
+#include "intrusiveList.h"
+#include "timerWheel.h"
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#if defined(LIST_RCU) || defined(LIST_THREAD_SAFE) || defined(LIST_ASYNC_FREE)
+#include <pthread.h>
+#endif
 
 // Macro for custom testing; does exit(1) on failure.
 #define CHECK(condition) do{ \
@@ -128,6 +137,9 @@ static void testComplex()
     CHECK(List_count(pList1) == 4);
     CHECK(List_first(pList1) == &one);
     CHECK(List_last(pList1) == &four);
+    //the join is linked both ways
+    CHECK(List_prev(pList1) == &three);
+    CHECK(List_prev(pList1) == &two);
 
 
     // Search
@@ -135,6 +147,11 @@ static void testComplex()
     CHECK(List_search(pList1, itemEquals, &two) == &two);
     CHECK(List_search(pList1, itemEquals, &two) == &two);
     CHECK(List_search(pList1, itemEquals, &one) == NULL);
+    //back before the head and on to the first item, the search starts at the head
+    List_first(pList1);
+    List_prev(pList1);
+    List_first(pList1);
+    CHECK(List_search(pList1, itemEquals, &one) == &one);
 
     List_free(pList1, s_free_do_nothing);
 }
@@ -315,15 +332,1777 @@ static void s_test(){
     CHECK(List_curr(pList) == &three);
     CHECK(List_last(pList) == &three);
     CHECK(List_first(pList) == &five);
-    
+
+    List_free(pList, s_free_do_nothing);
+    List_free(pList2, s_free_do_nothing);
+}
+
+static void s_test_bulk(){
+    void *items[LIST_MAX_NUM_NODES + 1];
+    int values[LIST_MAX_NUM_NODES + 1];
+    for(size_t i = 0; i <= LIST_MAX_NUM_NODES; ++i){
+        values[i] = i;
+        items[i] = &values[i];
+    }
+
+    List *pList = List_create();
+    CHECK(pList != NULL);
+    //earlier tests may still hold some nodes
+    int available = List_free_node_count();
+    CHECK(available >= 4);
+
+    //more than the pool can hold, nothing should be added
+    CHECK(List_append_all(pList, items, available + 1) == -1);
+    CHECK(List_count(pList) == 0);
+    CHECK(List_free_node_count() == available);
+
+    //append after an existing item
+    CHECK(List_append(pList, &values[0]) == 0);
+    CHECK(List_append_all(pList, items + 1, 3) == 0);
+    CHECK(List_count(pList) == 4);
+    CHECK(List_curr(pList) == &values[3]);
+    CHECK(List_free_node_count() == available - 4);
+
+    //take the rest of the pool in one go
+    CHECK(List_append_all(pList, items + 4, available - 4) == 0);
+    CHECK(List_free_node_count() == 0);
+    CHECK(List_append(pList, &values[0]) == -1);
+
+    //walk both ways to check the linkage
+    CHECK(List_first(pList) == &values[0]);
+    for(int i = 1; i < available; ++i){
+        CHECK(List_next(pList) == &values[i]);
+    }
+    CHECK(List_next(pList) == NULL);
+    for(int i = available; i > 0; --i){
+        CHECK(List_prev(pList) == &values[i - 1]);
+    }
+    CHECK(List_prev(pList) == NULL);
+
+    //free some nodes in the middle, they should be reused
+    List_first(pList);
+    List_next(pList);
+    CHECK(List_remove(pList) == &values[1]);
+    CHECK(List_remove(pList) == &values[2]);
+    CHECK(List_free_node_count() == 2);
+    CHECK(List_append_all(pList, items, 2) == 0);
+    CHECK(List_free_node_count() == 0);
+    CHECK(List_count(pList) == available);
+
+    List_free(pList, s_free_do_nothing);
+    CHECK(List_free_node_count() == available);
+}
+
+static void s_test_clone(){
+    int values[6] = {0, 1, 2, 3, 4, 5};
+    List *pList = List_create();
+    for(int i = 0; i < 6; ++i){
+        CHECK(List_append(pList, values + i) == 0);
+    }
+    int available = List_free_node_count();
+
+    //same items and current item, on nodes of its own
+    CHECK(List_first(pList) == values + 0);
+    CHECK(List_next(pList) == values + 1);
+    List *pClone = List_clone(pList);
+    CHECK(pClone != NULL && List_count(pClone) == 6);
+    CHECK(List_free_node_count() == available - 6);
+    CHECK(List_curr(pClone) == values + 1);
+    CHECK(List_prev(pClone) == values + 0);
+    CHECK(List_prev(pClone) == NULL);
+    for(int i = 0; i < 6; ++i){
+        CHECK(List_next(pClone) == values + i);
+    }
+    CHECK(List_next(pClone) == NULL);
+    CHECK(List_last(pClone) == values + 5);
+    CHECK(List_remove(pClone) == values + 5);
+    CHECK(List_count(pList) == 6 && List_last(pList) == values + 5);
+    List_free(pClone, s_free_do_nothing);
+
+    //beyond the end carries over, and an empty list clones too
+    List_next(pList);
+    pClone = List_clone(pList);
+    CHECK(List_curr(pClone) == NULL && List_prev(pClone) == values + 5);
+    List_free(pClone, s_free_do_nothing);
+    List *pEmpty = List_create();
+    pClone = List_clone(pEmpty);
+    CHECK(pClone != NULL && List_count(pClone) == 0 && List_next(pClone) == NULL);
+    List_free(pClone, s_free_do_nothing);
+    List_free(pEmpty, s_free_do_nothing);
+
+    //a range keeps the current item only if it is in the range
+    NodeRef second = List_next_ref(pList, List_first_ref(pList));
+    NodeRef fourth = List_next_ref(pList, List_next_ref(pList, second));
+    List_first(pList);
+    pClone = List_clone_range(pList, second, fourth);
+    CHECK(List_count(pClone) == 3 && List_curr(pClone) == NULL);
+    CHECK(List_next(pClone) == values + 1);
+    CHECK(List_last(pClone) == values + 3);
+    List_free(pClone, s_free_do_nothing);
+    List_next(pList);
+    List_next(pList);
+    pClone = List_clone_range(pList, second, second);
+    CHECK(List_count(pClone) == 1 && List_curr(pClone) == NULL);
+    List_free(pClone, s_free_do_nothing);
+    pClone = List_clone_range(pList, second, fourth);
+    CHECK(List_curr(pClone) == values + 2);
+    List_free(pClone, s_free_do_nothing);
+
+    //inline items are copied
+    List *pInline = List_create_inline(sizeof(int));
+    for(int i = 0; i < 3; ++i){
+        CHECK(List_append(pInline, values + i) == 0);
+    }
+    pClone = List_clone(pInline);
+    *(int *)List_first(pInline) = 9;
+    CHECK(*(int *)List_first(pClone) == 0);
+    CHECK(*(int *)List_last(pClone) == 2);
+    List_free(pClone, s_free_do_nothing);
+
+    //with too few nodes nothing is taken
+    List *pFill = List_create();
+    while(List_free_node_count() > 5){
+        CHECK(List_append(pFill, values) == 0);
+    }
+    CHECK(List_clone(pList) == NULL);
+    CHECK(List_free_node_count() == 5);
+    pClone = List_clone_range(pList, second, fourth);
+    CHECK(pClone != NULL && List_free_node_count() == 2);
+    List_free(pClone, s_free_do_nothing);
+
+    List_free(pFill, s_free_do_nothing);
+    List_free(pInline, s_free_do_nothing);
+    List_free(pList, s_free_do_nothing);
+    CHECK(List_free_node_count() == available + 6);
+}
+
+//item for the sort tests, seq tells equal keys apart
+typedef struct {
+    int key;
+    int seq;
+} SortItem;
+
+static int s_order_key(void *pItem1, void *pItem2){
+    return ((SortItem *)pItem1)->key - ((SortItem *)pItem2)->key;
+}
+
+//check pList is sorted by key and stable by seq, in both directions
+static void s_check_sorted(List *pList){
+    SortItem *prev = NULL;
+    for(SortItem *item = List_first(pList); item; item = List_next(pList)){
+        if(prev){
+            CHECK(prev->key < item->key || (prev->key == item->key && prev->seq < item->seq));
+        }
+        prev = item;
+    }
+    CHECK(List_last(pList) == prev);
+    int count = 0;
+    for(SortItem *item = List_last(pList); item; item = List_prev(pList)){
+        count++;
+    }
+    CHECK(count == List_count(pList));
+}
+
+static void s_test_sort(){
+    static SortItem items[LIST_MAX_NUM_NODES];
+    List *pList = List_create();
+    CHECK(pList != NULL);
+
+    //sorting an empty list does nothing
+    List_sort(pList, s_order_key);
+    CHECK(List_count(pList) == 0);
+    CHECK(List_first(pList) == NULL);
+
+    //few distinct keys so there are plenty of ties
+    int available = List_free_node_count();
+    for(int i = 0; i < available; ++i){
+        items[i].key = rand() % 10;
+        items[i].seq = i;
+        CHECK(List_append(pList, &items[i]) == 0);
+    }
+
+    //the current item should follow the node
+    List_first(pList);
+    List_next(pList);
+    SortItem *cur = List_curr(pList);
+    List_sort(pList, s_order_key);
+    CHECK(List_curr(pList) == cur);
+    CHECK(List_count(pList) == available);
+    s_check_sorted(pList);
+
+    //sorting a sorted list keeps it as is
+    List_sort(pList, s_order_key);
+    s_check_sorted(pList);
+
+    //beyond the end stays beyond the end
+    List_last(pList);
+    List_next(pList);
+    List_sort(pList, s_order_key);
+    CHECK(List_curr(pList) == NULL);
+    CHECK(List_prev(pList) == List_last(pList));
+
+    //move the later half out, then merge it back
+    //ties keep pList items first, so seq stays in order
+    List *pLater = List_create();
+    CHECK(pLater != NULL);
+    List_first(pList);
+    while(List_curr(pList)){
+        SortItem *item = List_curr(pList);
+        if(item->seq >= available / 2){
+            CHECK(List_remove(pList) == item);
+            CHECK(List_append(pLater, item) == 0);
+        }
+        else{
+            List_next(pList);
+        }
+    }
+    s_check_sorted(pList);
+    s_check_sorted(pLater);
+    SortItem *first = List_first(pList);
+    List_merge(pList, pLater, s_order_key);
+    CHECK(List_curr(pList) == first);
+    CHECK(List_count(pList) == available);
+    s_check_sorted(pList);
+
+    //merging into an empty list
+    List *pEmpty = List_create();
+    CHECK(pEmpty != NULL);
+    List_merge(pEmpty, pList, s_order_key);
+    CHECK(List_count(pEmpty) == available);
+    s_check_sorted(pEmpty);
+
+    List_free(pEmpty, s_free_do_nothing);
+}
+
+static void s_test_insert_sorted(){
+    static SortItem items[LIST_MAX_NUM_NODES];
+    List *pList = List_create();
+    CHECK(pList != NULL);
+    int available = List_free_node_count();
+
+    //half the pool, in random order with plenty of ties
+    int half = available / 2;
+    for(int i = 0; i < half; ++i){
+        items[i].key = rand() % 20;
+        items[i].seq = i;
+        CHECK(List_insert_sorted(pList, &items[i], s_order_key) == 0);
+        CHECK(List_curr(pList) == &items[i]);
+    }
+    CHECK(List_count(pList) == half);
+    s_check_sorted(pList);
+    //the nodes the index holds still count as free
+    CHECK(List_free_node_count() == available - half);
+
+    //another list gets every one of them, the index is dropped to make room
+    List *pOther = List_create();
+    CHECK(pOther != NULL);
+    int numOther = 0;
+    while(List_append(pOther, &items[0]) == 0){
+        ++numOther;
+    }
+    CHECK(numOther == available - half);
+    CHECK(List_free_node_count() == 0);
+    List_free(pOther, s_free_do_nothing);
+    CHECK(List_free_node_count() == available - half);
+    s_check_sorted(pList);
+
+    //removing drops the index and gives its nodes back
+    List_first(pList);
+    SortItem *removed = List_remove(pList);
+    CHECK(removed != NULL);
+    CHECK(List_free_node_count() == available - half + 1);
+    //insert again, the index is rebuilt
+    SortItem front = {-2, 0};
+    CHECK(List_insert_sorted(pList, &front, s_order_key) == 0);
+    CHECK(List_first(pList) == &front);
+    CHECK(List_remove(pList) == &front);
+    s_check_sorted(pList);
+
+    //keep inserting until the pool is full,
+    //the index must never make an insert fail
+    for(int i = half; i < available; ++i){
+        items[i].key = rand() % 20;
+        items[i].seq = i;
+        CHECK(List_insert_sorted(pList, &items[i], s_order_key) == 0);
+    }
+    //one more in place of the removed one
+    SortItem back = {20, available};
+    CHECK(List_insert_sorted(pList, &back, s_order_key) == 0);
+    CHECK(List_last(pList) == &back);
+    CHECK(List_count(pList) == available);
+    CHECK(List_free_node_count() == 0);
+    CHECK(List_insert_sorted(pList, &items[0], s_order_key) == -1);
+    s_check_sorted(pList);
+
+    //smallest and largest keys go to the ends
+    List_trim(pList);
+    List_first(pList);
+    List_remove(pList);
+    SortItem smallest = {-1, 0};
+    SortItem largest = {100, 0};
+    CHECK(List_insert_sorted(pList, &largest, s_order_key) == 0);
+    CHECK(List_insert_sorted(pList, &smallest, s_order_key) == 0);
+    CHECK(List_first(pList) == &smallest);
+    CHECK(List_last(pList) == &largest);
+
+    List_free(pList, s_free_do_nothing);
+    CHECK(List_free_node_count() == available);
+}
+
+typedef struct {
+    int value;
+    IListLink link;
+} LinkedItem;
+
+static bool s_link_value_equals(IListLink *pLink, void *pArg){
+    return ILIST_ENTRY(pLink, LinkedItem, link)->value == *(int *)pArg;
+}
+
+static int linkFreeCounter = 0;
+static void s_link_free(IListLink *pLink){
+    CHECK(pLink->listPrev == NULL && pLink->listNext == NULL);
+    linkFreeCounter++;
+}
+
+static void s_test_intrusive(){
+    LinkedItem items[6];
+    for(int i = 0; i < 6; ++i){
+        items[i].value = i;
+    }
+
+    IList list;
+    IList_init(&list);
+    int available = List_free_node_count();
+
+    //empty list
+    CHECK(IList_count(&list) == 0);
+    CHECK(IList_first(&list) == NULL);
+    CHECK(IList_last(&list) == NULL);
+    CHECK(IList_next(&list) == NULL);
+    CHECK(IList_prev(&list) == NULL);
+    CHECK(IList_remove(&list) == NULL);
+    CHECK(IList_trim(&list) == NULL);
+
+    //same order of operations as testComplex
+    IList_add(&list, &items[1].link);
+    IList_insert(&list, &items[2].link);
+    IList_prepend(&list, &items[3].link);
+    IList_append(&list, &items[4].link);
+    CHECK(IList_count(&list) == 4);
+    CHECK(IList_curr(&list) == &items[4].link);
+    //no pool node was taken
+    CHECK(List_free_node_count() == available);
+
+    CHECK(IList_first(&list) == &items[3].link);
+    CHECK(IList_prev(&list) == NULL);
+    CHECK(IList_next(&list) == &items[3].link);
+    CHECK(IList_next(&list) == &items[2].link);
+    CHECK(IList_next(&list) == &items[1].link);
+    CHECK(IList_next(&list) == &items[4].link);
+    CHECK(IList_next(&list) == NULL);
+    CHECK(IList_next(&list) == NULL);
+    CHECK(IList_prev(&list) == &items[4].link);
+    CHECK(ILIST_ENTRY(IList_curr(&list), LinkedItem, link) == &items[4]);
+
+    //add and insert from before head and beyond end
+    IList_first(&list);
+    IList_prev(&list);
+    IList_add(&list, &items[0].link);
+    CHECK(IList_first(&list) == &items[0].link);
+    IList_last(&list);
+    IList_next(&list);
+    IList_insert(&list, &items[5].link);
+    CHECK(IList_last(&list) == &items[5].link);
+    CHECK(IList_count(&list) == 6);
+
+    //search from before head finds the head
+    IList_first(&list);
+    IList_prev(&list);
+    IList_first(&list);
+    int value = 0;
+    CHECK(IList_search(&list, s_link_value_equals, &value) == &items[0].link);
+    value = 4;
+    CHECK(IList_search(&list, s_link_value_equals, &value) == &items[4].link);
+    CHECK(IList_search(&list, s_link_value_equals, &value) == &items[4].link);
+    value = 0;
+    CHECK(IList_search(&list, s_link_value_equals, &value) == NULL);
+    CHECK(IList_curr(&list) == NULL);
+
+    //remove and trim
+    IList_first(&list);
+    CHECK(IList_remove(&list) == &items[0].link);
+    CHECK(IList_curr(&list) == &items[3].link);
+    CHECK(IList_trim(&list) == &items[5].link);
+    CHECK(IList_curr(&list) == &items[4].link);
+    CHECK(items[0].link.listNext == NULL);
+
+    //concat moves everything, an unlinked item can be reused
+    IList other;
+    IList_init(&other);
+    IList_append(&other, &items[0].link);
+    IList_append(&other, &items[5].link);
+    IList_concat(&list, &other);
+    CHECK(IList_count(&other) == 0);
+    CHECK(IList_count(&list) == 6);
+    CHECK(IList_last(&list) == &items[5].link);
+    CHECK(IList_prev(&list) == &items[0].link);
+    CHECK(IList_prev(&list) == &items[4].link);
+
+    linkFreeCounter = 0;
+    IList_clear(&list, s_link_free);
+    CHECK(linkFreeCounter == 6);
+    CHECK(IList_count(&list) == 0);
+    CHECK(IList_first(&list) == NULL);
+
+    //List_search from before head through List_first finds the head too
+    int one = 1, two = 2;
+    List *pList = List_create();
+    CHECK(pList != NULL);
+    CHECK(List_append(pList, &one) == 0);
+    CHECK(List_append(pList, &two) == 0);
+    List_first(pList);
+    List_prev(pList);
+    List_first(pList);
+    CHECK(List_search(pList, itemEquals, &one) == &one);
+    List_free(pList, s_free_do_nothing);
+}
+
+typedef struct {
+    int id;
+    Timer timer;
+} TimedItem;
+
+typedef struct {
+    TimerWheel wheel;
+    int calls;
+    int expired[64];
+    int numExpired;
+    //timer the expire routine schedules again, and one it cancels
+    Timer *pRepeat;
+    Timer *pCancel;
+} WheelState;
+
+static void s_timer_expire(Timer **ppTimers, int count, void *pContext){
+    WheelState *pState = pContext;
+    CHECK(count > 0 && count <= TIMER_WHEEL_BATCH_SIZE);
+    pState->calls++;
+    for(int i = 0; i < count; ++i){
+        TimedItem *pItem = TIMER_ENTRY(ppTimers[i], TimedItem, timer);
+        CHECK(ppTimers[i]->pSlot == NULL && ppTimers[i]->ref == 0);
+        CHECK(ppTimers[i]->expiry == pState->wheel.now);
+        if(pState->numExpired < 64){
+            pState->expired[pState->numExpired] = pItem->id;
+        }
+        pState->numExpired++;
+        if(ppTimers[i] == pState->pRepeat){
+            CHECK(TimerWheel_schedule(&pState->wheel, ppTimers[i], 2) == 0);
+        }
+        if(pState->pCancel){
+            CHECK(TimerWheel_cancel(&pState->wheel, pState->pCancel));
+            pState->pCancel = NULL;
+        }
+    }
+}
+
+static void s_test_timer_wheel(){
+#if LIST_MAX_NUM_HEADS < TIMER_WHEEL_NUM_HEADS
+    //a pool too small for the wheel, which keeps none of the heads it took
+    TimerWheel wheel;
+    CHECK(TimerWheel_init(&wheel, s_timer_expire, NULL) == -1);
+    List *heads[LIST_MAX_NUM_HEADS];
+    for(int i = 0; i < LIST_MAX_NUM_HEADS; ++i){
+        CHECK((heads[i] = List_create()) != NULL);
+    }
+    for(int i = 0; i < LIST_MAX_NUM_HEADS; ++i){
+        List_free(heads[i], s_free_do_nothing);
+    }
+#else
+    const uint64_t span = (uint64_t)1 << (TIMER_WHEEL_LEVELS * __builtin_ctz(TIMER_WHEEL_SLOTS));
+    TimedItem items[64];
+    for(int i = 0; i < 64; ++i){
+        items[i].id = i;
+        items[i].timer.pSlot = NULL;
+        items[i].timer.ref = 0;
+    }
+    int available = List_free_node_count();
+
+    WheelState state = {0};
+    CHECK(TimerWheel_init(&state.wheel, s_timer_expire, &state) == 0);
+    CHECK(TimerWheel_count(&state.wheel) == 0);
+    CHECK(TimerWheel_advance(&state.wheel, 3) == 0);
+    CHECK(state.wheel.now == 3);
+
+    //one tick, a delay of 0, a higher level and beyond the span of the wheel
+    CHECK(TimerWheel_schedule(&state.wheel, &items[0].timer, 1) == 0);
+    CHECK(TimerWheel_schedule(&state.wheel, &items[1].timer, 0) == 0);
+    CHECK(TimerWheel_schedule(&state.wheel, &items[2].timer, TIMER_WHEEL_SLOTS + 2) == 0);
+    CHECK(TimerWheel_schedule(&state.wheel, &items[3].timer, span + 3) == 0);
+    CHECK(TimerWheel_schedule(&state.wheel, &items[4].timer, 2) == 0);
+    CHECK(TimerWheel_count(&state.wheel) == 5);
+    CHECK(List_free_node_count() == available - 5);
+
+    //cancel by handle, and moving a scheduled timer
+    CHECK(TimerWheel_cancel(&state.wheel, &items[4].timer));
+    CHECK(!TimerWheel_cancel(&state.wheel, &items[4].timer));
+    CHECK(items[4].timer.pSlot == NULL);
+    CHECK(TimerWheel_schedule(&state.wheel, &items[0].timer, 3) == 0);
+    CHECK(TimerWheel_count(&state.wheel) == 4);
+
+    //each timer expires on its tick, not one before
+    uint64_t expiries[] = {4, 6, TIMER_WHEEL_SLOTS + 5, span + 6};
+    int ids[] = {1, 0, 2, 3};
+    for(int i = 0; i < 4; ++i){
+        CHECK(TimerWheel_advance(&state.wheel, expiries[i] - 1 - state.wheel.now) == 0);
+        CHECK(TimerWheel_advance(&state.wheel, 1) == 1);
+        CHECK(state.expired[i] == ids[i]);
+    }
+    CHECK(TimerWheel_count(&state.wheel) == 0);
+    CHECK(List_free_node_count() == available);
+
+    //expiry in batches, in the order the timers were scheduled
+    int numTimers = List_free_node_count() < 40 ? List_free_node_count() : 40;
+    state.numExpired = 0;
+    state.calls = 0;
+    for(int i = 0; i < numTimers; ++i){
+        CHECK(TimerWheel_schedule(&state.wheel, &items[i].timer, span - 1) == 0);
+    }
+    CHECK(TimerWheel_advance(&state.wheel, span - 2) == 0);
+    CHECK(TimerWheel_advance(&state.wheel, 1) == numTimers);
+    CHECK(state.calls == (numTimers + TIMER_WHEEL_BATCH_SIZE - 1) / TIMER_WHEEL_BATCH_SIZE);
+    for(int i = 0; i < numTimers; ++i){
+        CHECK(state.expired[i] == i);
+    }
+
+    //the expire routine schedules a timer again and cancels another one
+    state.numExpired = 0;
+    CHECK(TimerWheel_schedule(&state.wheel, &items[0].timer, 1) == 0);
+    CHECK(TimerWheel_schedule(&state.wheel, &items[1].timer, 3) == 0);
+    state.pRepeat = &items[0].timer;
+    state.pCancel = &items[1].timer;
+    CHECK(TimerWheel_advance(&state.wheel, 1) == 1);
+    CHECK(TimerWheel_count(&state.wheel) == 1);
+    CHECK(TimerWheel_advance(&state.wheel, 4) == 2);
+    CHECK(state.numExpired == 3);
+    state.pRepeat = NULL;
+    CHECK(TimerWheel_advance(&state.wheel, 2) == 1);
+    CHECK(TimerWheel_count(&state.wheel) == 0);
+
+    //random delays and cancels, every timer expires on its own tick
+    srand(48);
+    for(int round = 0; round < 2000; ++round){
+        TimedItem *pItem = &items[rand() % 32];
+        if(rand() % 4 == 0){
+            TimerWheel_cancel(&state.wheel, &pItem->timer);
+        }else{
+            CHECK(TimerWheel_schedule(&state.wheel, &pItem->timer, rand() % (span * 2)) == 0);
+        }
+        TimerWheel_advance(&state.wheel, rand() % 3);
+    }
+    TimerWheel_advance(&state.wheel, span * 2);
+    CHECK(TimerWheel_count(&state.wheel) == 0);
+    CHECK(List_free_node_count() == available);
+
+    //freeing a wheel unschedules its timers
+    CHECK(TimerWheel_schedule(&state.wheel, &items[0].timer, 5) == 0);
+    TimerWheel_free(&state.wheel);
+    CHECK(items[0].timer.pSlot == NULL);
+    CHECK(List_free_node_count() == available);
+
+    //not enough heads, none are kept
+    List *lists[LIST_MAX_NUM_HEADS];
+    int numLists = 0;
+    while(numLists < LIST_MAX_NUM_HEADS && (lists[numLists] = List_create())){
+        numLists++;
+    }
+    if(numLists > 0){
+        List_free(lists[--numLists], s_free_do_nothing);
+        CHECK(TimerWheel_init(&state.wheel, s_timer_expire, &state) == -1);
+        CHECK((lists[numLists] = List_create()) != NULL);
+        numLists++;
+    }
+    while(numLists > 0){
+        List_free(lists[--numLists], s_free_do_nothing);
+    }
+#endif
+}
+
+//small record stored inside the nodes of an inline list
+typedef struct {
+    int key;
+    int value;
+} Pair;
+
+static int s_order_pair(void *pItem1, void *pItem2){
+    return ((Pair *)pItem1)->key - ((Pair *)pItem2)->key;
+}
+
+static bool s_pair_key_equals(void *pItem, void *pArg){
+    return ((Pair *)pItem)->key == *(int *)pArg;
+}
+
+static int pairFreeSum = 0;
+static void s_pair_free(void *pItem){
+    pairFreeSum += ((Pair *)pItem)->value;
+}
+
+static void s_test_inline(){
+    CHECK(List_create_inline(0) == NULL);
+    CHECK(List_create_inline(LIST_INLINE_MAX_SIZE + 1) == NULL);
+
+    List *pList = List_create_inline(sizeof(Pair));
+    CHECK(pList != NULL);
+
+    //values are copied, the caller's copy can change afterwards
+    Pair pair = {2, 20};
+    CHECK(List_add(pList, &pair) == 0);
+    pair.key = 1;
+    pair.value = 10;
+    CHECK(List_prepend(pList, &pair) == 0);
+    pair.key = 4;
+    pair.value = 40;
+    CHECK(List_append(pList, &pair) == 0);
+    pair.key = 3;
+    pair.value = 30;
+    CHECK(List_insert(pList, &pair) == 0);
+    CHECK(List_count(pList) == 4);
+
+    //handed out pointers point into the nodes
+    Pair *pCurr = List_curr(pList);
+    CHECK(pCurr != &pair);
+    CHECK(pCurr->key == 3 && pCurr->value == 30);
+    CHECK(((Pair *)List_first(pList))->key == 1);
+    CHECK(((Pair *)List_next(pList))->key == 2);
+    CHECK(((Pair *)List_next(pList))->key == 3);
+    CHECK(((Pair *)List_next(pList))->key == 4);
+    CHECK(List_next(pList) == NULL);
+    CHECK(((Pair *)List_last(pList))->value == 40);
+
+    //search hands node pointers to the comparator
+    int key = 2;
+    List_first(pList);
+    Pair *pFound = List_search(pList, s_pair_key_equals, &key);
+    CHECK(pFound != NULL && pFound->value == 20);
+    pFound->value = 21;
+    CHECK(((Pair *)List_curr(pList))->value == 21);
+
+    //remove and trim hand out a copy
+    Pair *pRemoved = List_remove(pList);
+    CHECK(pRemoved != NULL && pRemoved->key == 2 && pRemoved->value == 21);
+    CHECK(((Pair *)List_curr(pList))->key == 3);
+    Pair *pTrimmed = List_trim(pList);
+    CHECK(pTrimmed != NULL && pTrimmed->key == 4);
+    CHECK(((Pair *)List_curr(pList))->key == 3);
+
+    //sorted inserts and bulk appends copy as well
+    Pair pairs[3] = {{9, 90}, {0, 0}, {5, 50}};
+    void *pItems[3] = {&pairs[0], &pairs[1], &pairs[2]};
+    CHECK(List_append_all(pList, pItems, 3) == 0);
+    List_sort(pList, s_order_pair);
+    pair.key = 4;
+    pair.value = 40;
+    CHECK(List_insert_sorted(pList, &pair, s_order_pair) == 0);
+    int expected[] = {0, 1, 3, 4, 5, 9};
+    Pair *pItem = List_first(pList);
+    for(int i = 0; i < 6; ++i){
+        CHECK(pItem != NULL && pItem->key == expected[i]);
+        pItem = List_next(pList);
+    }
+    CHECK(pItem == NULL);
+
+    //concat with a list of the same item size
+    List *pOther = List_create_inline(sizeof(Pair));
+    CHECK(pOther != NULL);
+    pair.key = 7;
+    pair.value = 70;
+    CHECK(List_append(pOther, &pair) == 0);
+    List_concat(pList, pOther);
+    CHECK(((Pair *)List_last(pList))->key == 7);
+
+    //the free function sees every item
+    pairFreeSum = 0;
+    List_free(pList, s_pair_free);
+    CHECK(pairFreeSum == 0 + 10 + 30 + 40 + 50 + 90 + 70);
+}
+
+static void s_test_deque(){
+    int values[4] = {0, 1, 2, 3};
+    List *pList = List_create();
+    CHECK(List_pop_back(pList) == NULL);
+    CHECK(List_pop_front(pList) == NULL);
+
+    //1 2 0 3, pushes leave cur where it is
+    CHECK(List_push_back(pList, values + 1) == 0);
+    CHECK(List_curr(pList) == NULL);
+    CHECK(List_push_back(pList, values + 2) == 0);
+    CHECK(List_push_front(pList, values + 0) == 0);
+    CHECK(List_first(pList) == values + 0);
+    CHECK(List_push_front(pList, values + 1) == 0);
+    CHECK(List_push_back(pList, values + 3) == 0);
+    CHECK(List_count(pList) == 5);
+    CHECK(List_curr(pList) == values + 0);
+    CHECK(List_prev(pList) == values + 1);
+    CHECK(List_prev(pList) == NULL);
+    CHECK(List_last(pList) == values + 3);
+    CHECK(List_prev(pList) == values + 2);
+
+    //pops leave cur where it is, unless it is the popped item
+    CHECK(List_pop_front(pList) == values + 1);
+    CHECK(List_curr(pList) == values + 2);
+    CHECK(List_pop_back(pList) == values + 3);
+    CHECK(List_curr(pList) == values + 2);
+    CHECK(List_pop_back(pList) == values + 2);
+    CHECK(List_curr(pList) == values + 1);
+    CHECK(List_pop_front(pList) == values + 0);
+    CHECK(List_curr(pList) == values + 1);
+    CHECK(List_pop_front(pList) == values + 1);
+    CHECK(List_curr(pList) == NULL);
+    CHECK(List_count(pList) == 0);
+    CHECK(List_first(pList) == NULL && List_last(pList) == NULL);
+
+    //pushes fail without changing the list once the pool is empty
+    int pushed = 0;
+    while(List_push_back(pList, values + pushed % 4) == 0){
+        ++pushed;
+    }
+    CHECK(pushed == LIST_MAX_NUM_NODES);
+    CHECK(List_push_front(pList, values) == -1);
+    CHECK(List_count(pList) == LIST_MAX_NUM_NODES);
+    for(int i = 0; i < LIST_MAX_NUM_NODES; ++i){
+        CHECK(List_pop_front(pList) == values + i % 4);
+    }
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+
+    //inline lists pop a copy, and a sorted index is dropped
+    List *pInline = List_create_inline(sizeof(Pair));
+    for(int i = 0; i < 4; ++i){
+        Pair pair = {i, i * 10};
+        CHECK(List_insert_sorted(pInline, &pair, s_order_pair) == 0);
+    }
+    Pair pair = {9, 90};
+    CHECK(List_push_front(pInline, &pair) == 0);
+    CHECK(((Pair *)List_pop_back(pInline))->value == 30);
+    CHECK(((Pair *)List_pop_front(pInline))->key == 9);
+    CHECK(((Pair *)List_first(pInline))->key == 0);
+    CHECK(((Pair *)List_last(pInline))->key == 2);
+
+    List_free(pInline, s_free_do_nothing);
+    List_free(pList, s_free_do_nothing);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+
+static bool s_is_even(void *pItem, void *pArg){
+    return *(int *)pItem % 2 == 0;
+}
+
+static bool s_is_below(void *pItem, void *pArg){
+    return *(int *)pItem < *(int *)pArg;
 }
 
+static int s_numFreed = 0;
+
+static void s_count_free(void *pItem){
+    ++s_numFreed;
+}
+
+static void s_test_remove_if(){
+    int values[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    List *pList = List_create();
+    for(int i = 0; i < 10; ++i){
+        CHECK(List_append(pList, values + i) == 0);
+    }
+
+    //the current item is taken out, so the next one that stays becomes current
+    List_first(pList);
+    List_next(pList);
+    List_next(pList);
+    CHECK(List_remove_if(pList, s_is_even, NULL, s_count_free) == 5);
+    CHECK(s_numFreed == 5);
+    CHECK(List_count(pList) == 5);
+    CHECK(List_curr(pList) == values + 3);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES - 5);
+
+    //links are right both ways
+    int expected = 1;
+    for(int *pItem = List_first(pList); pItem; pItem = List_next(pList)){
+        CHECK(*pItem == expected);
+        expected += 2;
+    }
+    expected = 9;
+    for(int *pItem = List_last(pList); pItem; pItem = List_prev(pList)){
+        CHECK(*pItem == expected);
+        expected -= 2;
+    }
+
+    //nothing matches, cur and the list stay as they are
+    List_first(pList);
+    CHECK(List_remove_if(pList, s_is_even, NULL, NULL) == 0);
+    CHECK(List_curr(pList) == values + 1);
+
+    //a current item that stays stays current, without a free function
+    List_last(pList);
+    int below = 5;
+    CHECK(List_remove_if(pList, s_is_below, &below, NULL) == 2);
+    CHECK(List_curr(pList) == values + 9);
+    CHECK(List_first(pList) == values + 5);
+    CHECK(List_next(pList) == values + 7);
+
+    //the last items and the current one with them, cur is left beyond the end
+    below = 10;
+    CHECK(List_remove_if(pList, s_is_below, &below, NULL) == 3);
+    CHECK(List_count(pList) == 0);
+    CHECK(List_curr(pList) == NULL);
+    CHECK(List_prev(pList) == NULL);
+    CHECK(List_append(pList, values) == 0);
+    CHECK(List_first(pList) == values && List_last(pList) == values);
+
+    List_free(pList, s_free_do_nothing);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+
+//items of the save test are indexes into this table
+static int savedValues[8] = {10, 11, 12, 13, 14, 15, 16, 17};
+
+static bool s_save_value(FILE *pFile, void *pItem){
+    int index = (int *)pItem - savedValues;
+    return fwrite(&index, sizeof(index), 1, pFile) == 1;
+}
+
+static bool s_load_value(FILE *pFile, void **ppItem){
+    int index;
+    if(fread(&index, sizeof(index), 1, pFile) != 1 || index < 0 || index >= 8){
+        return false;
+    }
+    *ppItem = savedValues + index;
+    return true;
+}
+
+static void s_test_save(){
+    //every list of earlier tests should be freed by now
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+
+    List *pLists[3];
+    pLists[0] = List_create();
+    pLists[1] = List_create_inline(sizeof(Pair));
+    pLists[2] = List_create();
+    CHECK(pLists[0] && pLists[1] && pLists[2]);
+    for(int i = 0; i < 5; ++i){
+        CHECK(List_append(pLists[0], savedValues + i) == 0);
+        Pair pair = {i, i * 10};
+        CHECK(List_prepend(pLists[1], &pair) == 0);
+    }
+    //cur in the middle, beyond end, and before head of an empty list
+    List_first(pLists[0]);
+    List_next(pLists[0]);
+    List_last(pLists[1]);
+    List_next(pLists[1]);
+    List_first(pLists[2]);
+
+    FILE *pFile = tmpfile();
+    CHECK(pFile != NULL);
+    CHECK(List_save(pFile, pLists, 3, s_save_value) == 0);
+
+    //loading needs an unused pool
+    rewind(pFile);
+    List *pLoaded[3];
+    CHECK(List_load(pFile, pLoaded, 3, s_load_value) == -1);
+    for(int i = 0; i < 3; ++i){
+        List_free(pLists[i], s_free_do_nothing);
+    }
+    //the failed load leaves the pool empty
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+
+    //not enough room for the lists
+    rewind(pFile);
+    CHECK(List_load(pFile, pLoaded, 2, s_load_value) == -1);
+
+    rewind(pFile);
+    CHECK(List_load(pFile, pLoaded, 3, s_load_value) == 3);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES - 10);
+
+    //pointer list, with cur on the second item
+    CHECK(List_count(pLoaded[0]) == 5);
+    CHECK(List_curr(pLoaded[0]) == savedValues + 1);
+    CHECK(List_first(pLoaded[0]) == savedValues + 0);
+    for(int i = 1; i < 5; ++i){
+        CHECK(List_next(pLoaded[0]) == savedValues + i);
+    }
+    CHECK(List_next(pLoaded[0]) == NULL);
+    CHECK(List_prev(pLoaded[0]) == savedValues + 4);
+
+    //inline list, with cur beyond end
+    CHECK(List_count(pLoaded[1]) == 5);
+    CHECK(List_curr(pLoaded[1]) == NULL);
+    CHECK(((Pair *)List_prev(pLoaded[1]))->key == 0);
+    CHECK(((Pair *)List_first(pLoaded[1]))->value == 40);
+
+    //empty list, before head
+    CHECK(List_count(pLoaded[2]) == 0);
+    CHECK(List_curr(pLoaded[2]) == NULL);
+
+    //the loaded pool keeps working
+    CHECK(List_append(pLoaded[2], savedValues + 7) == 0);
+    List_concat(pLoaded[0], pLoaded[2]);
+    CHECK(List_last(pLoaded[0]) == savedValues + 7);
+    CHECK(List_prev(pLoaded[0]) == savedValues + 4);
+    List *pNew = List_create();
+    CHECK(pNew != NULL);
+    List_free(pNew, s_free_do_nothing);
+
+    //a truncated file fails and leaves the pool empty
+    List_free(pLoaded[0], s_free_do_nothing);
+    List_free(pLoaded[1], s_free_do_nothing);
+    fflush(pFile);
+    CHECK(ftruncate(fileno(pFile), 40) == 0);
+    rewind(pFile);
+    CHECK(List_load(pFile, pLoaded, 3, s_load_value) == -1);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+    fclose(pFile);
+}
+
+static void s_test_pool(){
+    char path[] = "/tmp/listPoolXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    //lists of the static pool are left alone while a file is attached
+    List *pStatic = List_create();
+    CHECK(pStatic != NULL && List_append(pStatic, savedValues) == 0);
+    int staticFree = List_free_node_count();
+
+    //the empty file becomes an empty pool
+    CHECK(List_pool_attach(path, false) == 0);
+    CHECK(List_pool_attach(path, false) == -1);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+    List *pList = List_create_inline(sizeof(Pair));
+    CHECK(pList != NULL);
+    for(int i = 0; i < 4; ++i){
+        Pair pair = {i, i * i};
+        CHECK(List_append(pList, &pair) == 0);
+    }
+    List_first(pList);
+    List_next(pList);
+    int id = List_id(pList);
+    CHECK(List_from_id(id) == pList);
+    List_pool_detach();
+
+    CHECK(List_free_node_count() == staticFree);
+    CHECK(List_curr(pStatic) == savedValues);
+
+    //reattaching finds the list as it was left
+    CHECK(List_pool_attach(path, false) == 0);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES - 4);
+    pList = List_from_id(id);
+    CHECK(pList != NULL && List_count(pList) == 4);
+    CHECK(((Pair *)List_curr(pList))->key == 1);
+    CHECK(List_from_id(id + 1) == NULL && List_from_id(-1) == NULL);
+
+    //another process reads it through refs, without moving the current item
+    pid_t child = fork();
+    CHECK(child >= 0);
+    if(child == 0){
+        List_pool_detach();
+        List *pShared = List_pool_attach(path, true) == 0 ? List_from_id(id) : NULL;
+        int key = 0;
+        bool ok = pShared != NULL;
+        for(NodeRef ref = ok ? List_first_ref(pShared) : 0; ref; ref = List_next_ref(pShared, ref)){
+            ok = ok && ((Pair *)List_ref_item(pShared, ref))->value == key * key;
+            ++key;
+        }
+        _exit(ok && key == 4 ? 0 : 1);
+    }
+    int status;
+    CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    NodeRef ref = List_last_ref(pList);
+    CHECK(((Pair *)List_ref_item(pList, ref))->key == 3);
+    ref = List_prev_ref(pList, List_prev_ref(pList, ref));
+    CHECK(((Pair *)List_ref_item(pList, ref))->key == 1);
+    CHECK(List_prev_ref(pList, List_first_ref(pList)) == 0);
+    List_free(pList, s_free_do_nothing);
+    List_pool_detach();
+
+    //a file of another size does not hold a pool
+    CHECK(truncate(path, 1) == 0);
+    CHECK(List_pool_attach(path, false) == -1);
+    CHECK(List_pool_attach(path, true) == -1);
+    unlink(path);
+
+    List_free(pStatic, s_free_do_nothing);
+}
+
+static void s_test_pool_map(){
+    int staticFree = List_free_node_count();
+
+    //huge pages and NUMA placement fall back to what the machine has
+    CHECK(List_pool_map(LIST_POOL_HUGE_PAGES | LIST_POOL_NUMA) == 0);
+    CHECK(List_pool_map(0) == -1);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+
+    //nodes come from every partition once the first ones are full
+    List *pList = List_create();
+    CHECK(pList != NULL);
+    for(int i = 0; i < LIST_MAX_NUM_NODES; ++i){
+        CHECK(List_append(pList, savedValues) == 0);
+    }
+    CHECK(List_append(pList, savedValues) == -1);
+
+    ListPlacement placement;
+    if(List_pool_placement(&placement) == 0){
+        CHECK(placement.numPartitions >= 1 && placement.numPartitions <= LIST_MAX_NUM_PARTITIONS);
+        CHECK(placement.pageSize == 4096 || placement.pageSize == 2 * 1024 * 1024);
+        int nodesInUse = 0;
+        int pages = 0;
+        for(int i = 0; i < placement.numPartitions; ++i){
+            nodesInUse += placement.partitions[i].nodesInUse;
+            pages += placement.partitions[i].pagesLocal + placement.partitions[i].pagesRemote;
+        }
+        CHECK(nodesInUse == LIST_MAX_NUM_NODES);
+        CHECK(pages >= 1);
+    }
+
+    //recycled nodes are handed out again
+    List_first(pList);
+    CHECK(List_remove(pList) == savedValues);
+    CHECK(List_append(pList, savedValues + 1) == 0);
+    CHECK(List_last(pList) == savedValues + 1);
+    List_free(pList, s_free_do_nothing);
+    List_pool_detach();
+
+    //without options it is a plain anonymous pool
+    CHECK(List_pool_map(0) == 0);
+    CHECK(List_pool_placement(&placement) == 0);
+    CHECK(placement.numPartitions == 1);
+    List_pool_detach();
+
+    CHECK(List_free_node_count() == staticFree);
+}
+
+#ifdef LIST_ALIGNED_HEADS
+static void s_test_aligned_heads(){
+    //neighbouring heads never share a cache line
+    List *pList1 = List_create();
+    List *pList2 = List_create();
+    CHECK((uintptr_t)pList1 % LIST_CACHE_LINE_SIZE == 0);
+    CHECK((uintptr_t)pList2 % LIST_CACHE_LINE_SIZE == 0);
+    CHECK(sizeof(List) % LIST_CACHE_LINE_SIZE == 0);
+    List_free(pList1, s_free_do_nothing);
+    List_free(pList2, s_free_do_nothing);
+}
+#endif
+
+#ifdef LIST_STATS
+static void s_test_stats(){
+    ListStats stats;
+    List_stats_reset();
+    List_stats_get(&stats);
+    int nodesInUse = stats.nodesInUse;
+    int headsInUse = stats.headsInUse;
+    CHECK(stats.nodesHighWater == nodesInUse);
+    CHECK(stats.opCounts[LIST_OP_ADD] == 0);
+
+    int one = 1, two = 2;
+    List *pList = List_create();
+    CHECK(List_add(pList, &one) == 0);
+    CHECK(List_append(pList, &two) == 0);
+    CHECK(List_count(pList) == 2);
+    CHECK(List_remove(pList) == &two);
+
+    List_stats_get(&stats);
+    CHECK(stats.nodesInUse == nodesInUse + 1);
+    CHECK(stats.nodesHighWater == nodesInUse + 2);
+    CHECK(stats.headsInUse == headsInUse + 1);
+    //nested calls should not be counted twice
+    CHECK(stats.opCounts[LIST_OP_ADD] == 1);
+    CHECK(stats.opCounts[LIST_OP_APPEND] == 1);
+    CHECK(stats.opCounts[LIST_OP_REMOVE] == 1);
+    CHECK(stats.opCounts[LIST_OP_CREATE] == 1);
+    CHECK(strcmp(List_op_name(LIST_OP_APPEND), "List_append") == 0);
+
+    //run the pool dry
+    int available = List_free_node_count();
+    for(int i = 0; i < available; ++i){
+        CHECK(List_add(pList, &one) == 0);
+    }
+    CHECK(List_add(pList, &one) == -1);
+    CHECK(List_insert(pList, &one) == -1);
+    List_stats_get(&stats);
+    CHECK(stats.nodeFailures == 2);
+    CHECK(stats.nodesInUse == LIST_MAX_NUM_NODES);
+    CHECK(stats.nodesHighWater == LIST_MAX_NUM_NODES);
+
+    //the dump should hold the length of our list
+    char expected[64];
+    snprintf(expected, sizeof(expected), "\"length\":%d}", List_count(pList));
+    char buffer[4096] = {0};
+    FILE *pFile = tmpfile();
+    CHECK(pFile != NULL);
+    CHECK(List_stats_dump_json(pFile) == 0);
+    rewind(pFile);
+    CHECK(fread(buffer, 1, sizeof(buffer) - 1, pFile) > 0);
+    fclose(pFile);
+    CHECK(buffer[0] == '{');
+    CHECK(strstr(buffer, "\"nodeFailures\":2") != NULL);
+    CHECK(strstr(buffer, "\"List_add\":") != NULL);
+    CHECK(strstr(buffer, expected) != NULL);
+
+    List_free(pList, s_free_do_nothing);
+    List_stats_get(&stats);
+    CHECK(stats.nodesInUse == nodesInUse);
+    CHECK(stats.headsInUse == headsInUse);
+}
+#endif
+
+#ifdef LIST_TRACE
+static int traceCallbackCounter = 0;
+static void s_trace_callback(const ListTraceEvent *pEvent, void *pContext){
+    CHECK(pContext == &traceCallbackCounter);
+    CHECK(pEvent->op >= 0 && pEvent->op < LIST_NUM_OPS);
+    traceCallbackCounter++;
+}
+
+//a callback calling List_* itself, which is traced without calling it again
+static int nestedCallbackCounter = 0;
+static void s_trace_nested_callback(const ListTraceEvent *pEvent, void *pContext){
+    CHECK(List_count(pContext) == 1);
+    nestedCallbackCounter++;
+}
+
+static void s_test_trace(){
+    List_trace_reset();
+    List_trace_set_callback(s_trace_callback, &traceCallbackCounter);
+
+    int one = 1, two = 2;
+    List *pList = List_create();
+    CHECK(pList != NULL);
+    CHECK(List_append(pList, &one) == 0);
+    CHECK(List_append(pList, &two) == 0);
+    List_first(pList);
+    CHECK(List_search(pList, itemEquals, &two) == &two);
+    List_free(pList, s_free_do_nothing);
+    CHECK(traceCallbackCounter == 6);
+
+    //each call should be recorded once, in order
+    ListTraceEvent events[8];
+    CHECK(List_trace_recent(events, 8) == 6);
+    CHECK(events[0].op == LIST_OP_CREATE);
+    CHECK(events[1].op == LIST_OP_APPEND);
+    CHECK(events[2].op == LIST_OP_APPEND);
+    CHECK(events[3].op == LIST_OP_FIRST);
+    CHECK(events[4].op == LIST_OP_SEARCH);
+    CHECK(events[5].op == LIST_OP_FREE);
+    CHECK(List_trace_recent(events, 2) == 2);
+    CHECK(events[1].op == LIST_OP_FREE);
+
+    ListTraceSummary summary;
+    List_trace_summary(LIST_OP_APPEND, &summary);
+    CHECK(summary.count == 2);
+    CHECK(summary.min <= summary.p50 && summary.p50 <= summary.max);
+    CHECK(summary.p99 <= summary.max);
+    CHECK(summary.total >= summary.max);
+    List_trace_summary(LIST_OP_TRIM, &summary);
+    CHECK(summary.count == 0 && summary.p50 == 0);
+
+    FILE *pFile = tmpfile();
+    CHECK(pFile != NULL);
+    CHECK(List_trace_dump(pFile) == 0);
+    fclose(pFile);
+
+    pList = List_create();
+    CHECK(List_append(pList, &one) == 0);
+    List_trace_reset();
+    List_trace_set_callback(s_trace_nested_callback, pList);
+    List_first(pList);
+    List_last(pList);
+    CHECK(nestedCallbackCounter == 2);
+    CHECK(List_trace_recent(events, 8) == 4);
+    CHECK(events[0].op == LIST_OP_FIRST && events[1].op == LIST_OP_COUNT);
+    CHECK(events[2].op == LIST_OP_LAST && events[3].op == LIST_OP_COUNT);
+    List_trace_set_callback(NULL, NULL);
+    List_free(pList, s_free_do_nothing);
+
+    List_trace_set_callback(NULL, NULL);
+    List_trace_reset();
+    CHECK(List_trace_recent(events, 8) == 0);
+}
+#endif
+
+#ifdef LIST_RECORD
+//list a free routine looks at, its calls are part of List_free
+static List *s_recordOther;
+static void s_record_free(void *pItem){
+    CHECK(List_count(s_recordOther) == 1);
+}
+
+static bool s_record_any(void *pItem, void *pArg){
+    return true;
+}
+
+//reads the next recorded call, checks it and returns its tokens in pTokens
+static ListRecordEntry s_next_record(FILE *pFile, ListOp op, int list, uint64_t *pTokens){
+    ListRecordEntry entry;
+    CHECK(fread(&entry, sizeof(entry), 1, pFile) == 1);
+    CHECK(entry.op == op && entry.list == (uint32_t)list);
+    CHECK(entry.count <= 4 && fread(pTokens, sizeof(uint64_t), entry.count, pFile) == entry.count);
+    return entry;
+}
+
+static void s_test_record(){
+    FILE *pFile = tmpfile();
+    CHECK(pFile != NULL);
+    CHECK(List_record_stop() == -1);
+    CHECK(List_record_start(pFile) == 0);
+    CHECK(List_record_start(pFile) == -1);
+
+    int one = 1, two = 2, seven = 7;
+    List *pList = List_create();
+    List *pInline = List_create_inline(sizeof(int));
+    CHECK(pList != NULL && pInline != NULL);
+    int id = List_id(pList);
+    int inlineId = List_id(pInline);
+    void *items[] = {&one, &two};
+    CHECK(List_append_all(pList, items, 2) == 0);
+    CHECK(List_search(pList, itemEquals, &two) == &two);
+    CHECK(List_push_back(pInline, &seven) == 0);
+    s_recordOther = pInline;
+    List_free(pList, s_record_free);
+    CHECK(List_remove_if(pInline, s_record_any, NULL, NULL) == 1);
+    List_free(pInline, s_free_do_nothing);
+    CHECK(List_record_stop() == 0);
+
+    //calls after the recording stopped are not written
+    pList = List_create();
+    List_free(pList, s_free_do_nothing);
+
+    rewind(pFile);
+    ListRecordHeader header;
+    CHECK(fread(&header, sizeof(header), 1, pFile) == 1);
+    CHECK(header.magic == LIST_RECORD_MAGIC && header.version == LIST_RECORD_VERSION);
+    CHECK(header.numHeads == LIST_MAX_NUM_HEADS && header.numNodes == LIST_MAX_NUM_NODES);
+    CHECK(header.entrySize == sizeof(ListRecordEntry));
+
+    uint64_t tokens[4];
+    s_next_record(pFile, LIST_OP_CREATE, id, tokens);
+    CHECK(s_next_record(pFile, LIST_OP_CREATE_INLINE, inlineId, tokens).other == sizeof(int));
+    ListRecordEntry entry = s_next_record(pFile, LIST_OP_APPEND_ALL, id, tokens);
+    CHECK(entry.other == 2 && entry.count == 2);
+    CHECK(tokens[0] == (uintptr_t)&one && tokens[1] == (uintptr_t)&two);
+    CHECK(s_next_record(pFile, LIST_OP_SEARCH, id, tokens).token == (uintptr_t)&two);
+    //inline items are recorded by value
+    CHECK(s_next_record(pFile, LIST_OP_PUSH_BACK, inlineId, tokens).token == 7);
+    //the List_count of s_record_free is not there
+    s_next_record(pFile, LIST_OP_FREE, id, tokens);
+    entry = s_next_record(pFile, LIST_OP_REMOVE_IF, inlineId, tokens);
+    CHECK(entry.count == 1 && tokens[0] == 7);
+    s_next_record(pFile, LIST_OP_FREE, inlineId, tokens);
+    CHECK(fread(&entry, sizeof(entry), 1, pFile) == 0);
+    fclose(pFile);
+}
+#endif
+
+#ifdef LIST_RCU
+//list the readers search while the writer changes it
+static List *s_rcuList;
+//set by the writer once it is done, and by a reader that found a broken item
+static bool s_rcuDone;
+static bool s_rcuBroken;
+//number of readers that are running
+static int s_rcuNumStarted;
+
+//an item is a pair whose value can only be made from its key, a recycled node is not
+static bool s_rcu_match(void *pItem, void *pKey){
+    Pair *pPair = pItem;
+    if(pPair->value != pPair->key * 3 + 1){
+        __atomic_store_n(&s_rcuBroken, true, __ATOMIC_RELAXED);
+    }
+    return pPair->key == *(int *)pKey;
+}
+
+static void *s_rcu_reader(void *arg){
+    int key = 0;
+    __atomic_add_fetch(&s_rcuNumStarted, 1, __ATOMIC_RELAXED);
+    while(!__atomic_load_n(&s_rcuDone, __ATOMIC_RELAXED)){
+        List_rcu_read_lock();
+        Pair *pPair = List_rcu_search(s_rcuList, s_rcu_match, &key);
+        if(pPair && pPair->key != key){
+            __atomic_store_n(&s_rcuBroken, true, __ATOMIC_RELAXED);
+        }
+        //walking by refs is just as safe
+        for(NodeRef ref = List_first_ref(s_rcuList); ref; ref = List_next_ref(s_rcuList, ref)){
+            s_rcu_match(List_ref_item(s_rcuList, ref), &key);
+        }
+        List_rcu_read_unlock();
+        key = (key + 7) % 200;
+        //let the writer in on machines with few cores
+        sched_yield();
+    }
+    List_rcu_thread_exit();
+    return NULL;
+}
+
+static void s_test_rcu(){
+    s_rcuList = List_create_inline(sizeof(Pair));
+    CHECK(s_rcuList != NULL);
+
+    pthread_t readers[4];
+    for(int i = 0; i < 4; ++i){
+        CHECK(pthread_create(readers + i, NULL, s_rcu_reader, NULL) == 0);
+    }
+    while(__atomic_load_n(&s_rcuNumStarted, __ATOMIC_RELAXED) < 4){
+        sched_yield();
+    }
+
+    //keep about half the pool in the list, adding at the back and taking from the front,
+    //so removed nodes have to go through grace periods to be reused
+    for(int i = 0; i < 5000; ++i){
+        Pair pair = {i % 200, (i % 200) * 3 + 1};
+        if(List_append(s_rcuList, &pair) != 0){
+            List_rcu_synchronize();
+            CHECK(List_append(s_rcuList, &pair) == 0);
+        }
+        if(List_count(s_rcuList) > LIST_MAX_NUM_NODES / 2){
+            List_first(s_rcuList);
+            CHECK(((Pair *)List_remove(s_rcuList))->key == (i - LIST_MAX_NUM_NODES / 2 + 200) % 200);
+        }
+        //let the readers in just as often
+        if(i % 8 == 0){
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&s_rcuDone, true, __ATOMIC_RELAXED);
+    for(int i = 0; i < 4; ++i){
+        pthread_join(readers[i], NULL);
+    }
+    CHECK(!s_rcuBroken);
+
+    //nested read locks, and everything is recycled once readers are gone
+    List_rcu_read_lock();
+    List_rcu_read_lock();
+    int key = 199;
+    CHECK(((Pair *)List_rcu_search(s_rcuList, s_rcu_match, &key))->key == 199);
+    List_rcu_read_unlock();
+    List_rcu_read_unlock();
+    List_free(s_rcuList, s_free_do_nothing);
+    List_rcu_synchronize();
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+    List_rcu_thread_exit();
+}
+#endif
+
+#ifdef LIST_THREAD_SAFE
+static List *s_tsShared = NULL;
+static int s_tsValues[4][8];
+static long s_tsAdded = 0;
+static long s_tsTrimmed = 0;
+
+static void *s_ts_worker(void *pArg){
+    int *values = pArg;
+    List *pOwn = List_create();
+    CHECK(pOwn != NULL);
+    long added = 0;
+    long trimmed = 0;
+    for(int i = 0; i < 2000; ++i){
+        //a list of its own, which no other thread waits on
+        for(int j = 0; j < 8; ++j){
+            CHECK(List_ts_append(pOwn, values + j) == 0);
+        }
+        CHECK(List_ts_count(pOwn) == 8);
+        for(int j = 7; j >= 0; --j){
+            CHECK(List_ts_trim(pOwn) == values + j);
+        }
+
+        //a new list concatenated onto the shared one, then one item taken back off
+        List *pTmp = List_create();
+        CHECK(pTmp != NULL);
+        CHECK(List_append(pTmp, values + i % 8) == 0);
+        added += values[i % 8];
+        List_ts_concat(s_tsShared, pTmp);
+        int *pItem = List_ts_trim(s_tsShared);
+        CHECK(pItem != NULL);
+        trimmed += *pItem;
+    }
+    List_ts_free(pOwn, s_free_do_nothing);
+    __atomic_add_fetch(&s_tsAdded, added, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s_tsTrimmed, trimmed, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void s_test_ts(){
+    s_tsShared = List_create();
+    CHECK(s_tsShared != NULL);
+
+    pthread_t workers[4];
+    for(int i = 0; i < 4; ++i){
+        for(int j = 0; j < 8; ++j){
+            s_tsValues[i][j] = i * 8 + j;
+        }
+        CHECK(pthread_create(workers + i, NULL, s_ts_worker, s_tsValues[i]) == 0);
+    }
+    for(int i = 0; i < 4; ++i){
+        pthread_join(workers[i], NULL);
+    }
+
+    //every item put on the shared list came off it once
+    CHECK(List_ts_count(s_tsShared) == 0);
+    CHECK(s_tsAdded == s_tsTrimmed);
+
+    //the lock can be held across a whole walk
+    int values[3] = {1, 2, 3};
+    void *pItems[2] = {values, values + 1};
+    List *pOther = List_create();
+    CHECK(List_ts_append_all(s_tsShared, pItems, 2) == 0);
+    CHECK(List_ts_prepend(pOther, values + 2) == 0);
+    List_ts_concat(pOther, s_tsShared);
+    List_ts_lock(pOther);
+    int sum = 0;
+    for(int *pItem = List_first(pOther); pItem; pItem = List_next(pOther)){
+        sum += *pItem;
+    }
+    List_ts_unlock(pOther);
+    CHECK(sum == 6);
+    List_ts_free(pOther, s_free_do_nothing);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+#endif
+
+#if LIST_SMALL_SIZE
+//whether ref is one of the home nodes of the head of pList
+static bool s_is_home_node(List *pList, NodeRef ref){
+    NodeRef first = List_id(pList) * LIST_SMALL_SIZE + 1;
+    return ref >= first && ref < first + LIST_SMALL_SIZE;
+}
+
+static void s_test_small_size(){
+    int items[LIST_SMALL_SIZE + 1];
+    int available = List_free_node_count();
+    List *pList = List_create();
+    List *pOther = List_create();
+    CHECK(pList != NULL && pOther != NULL);
+
+    //the first items go into the home nodes of the head, side by side
+    for(int i = 0; i <= LIST_SMALL_SIZE; ++i){
+        CHECK(List_append(pList, items + i) == 0);
+    }
+    NodeRef ref = List_first_ref(pList);
+    for(int i = 0; i < LIST_SMALL_SIZE; ++i){
+        CHECK(s_is_home_node(pList, ref));
+        NodeRef next = List_next_ref(pList, ref);
+        CHECK(i + 1 == LIST_SMALL_SIZE || next == ref + 1);
+        ref = next;
+    }
+    //the ones past them come from the rest of the pool, and all are counted alike
+    CHECK(!s_is_home_node(pList, ref));
+    CHECK(List_free_node_count() == available - LIST_SMALL_SIZE - 1);
+
+    //a home node given back goes to the same head again
+    List_first(pList);
+    CHECK(List_remove(pList) == items);
+    CHECK(List_push_front(pOther, items) == 0);
+    CHECK(s_is_home_node(pOther, List_first_ref(pOther)));
+    CHECK(List_prepend(pList, items) == 0);
+    CHECK(s_is_home_node(pList, List_first_ref(pList)));
+
+    //other lists only get home nodes once nothing else is left, so the pool holds as much
+    int count = 0;
+    while(List_push_back(pOther, items) == 0){
+        ++count;
+    }
+    CHECK(List_free_node_count() == 0);
+    CHECK(count == available - LIST_SMALL_SIZE - 2);
+    CHECK(List_pop_front(pList) == items);
+    CHECK(List_push_back(pOther, items) == 0);
+    CHECK(s_is_home_node(pList, List_last_ref(pOther)));
+
+    List_free(pList, s_free_do_nothing);
+    List_free(pOther, s_free_do_nothing);
+    CHECK(List_free_node_count() == available);
+}
+#endif
+
+#ifdef LIST_SNAPSHOT
+static int s_order_desc(void *pItem1, void *pItem2){
+    return *(int *)pItem2 - *(int *)pItem1;
+}
+
+//check pList holds the items pointed to by pExpected, in both directions
+static void s_check_items(List *pList, int **pExpected, int count){
+    CHECK(List_count(pList) == count);
+    int i = 0;
+    for(void *pItem = List_first(pList); pItem; pItem = List_next(pList)){
+        CHECK(i < count && pItem == pExpected[i++]);
+    }
+    CHECK(i == count);
+    for(void *pItem = List_last(pList); pItem; pItem = List_prev(pList)){
+        CHECK(pItem == pExpected[--i]);
+    }
+    CHECK(i == 0);
+}
+
+static void s_test_snapshot(){
+    int values[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    int *before[8];
+    List *pList = List_create();
+    for(int i = 0; i < 8; ++i){
+        CHECK(List_append(pList, values + i) == 0);
+        before[i] = values + i;
+    }
+
+    //made in O(1), without a node
+    CHECK(List_first(pList) == values + 0);
+    CHECK(List_next(pList) == values + 1);
+    List *pSnapshot = List_snapshot(pList);
+    CHECK(pSnapshot != NULL && List_snapshot_is_valid(pSnapshot));
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES - 8);
+    CHECK(List_curr(pSnapshot) == values + 1);
+    s_check_items(pSnapshot, before, 8);
+
+    //every kind of change leaves the snapshot as it was
+    CHECK(List_pop_front(pList) == values + 0);
+    CHECK(List_push_back(pList, values + 8) == 0);
+    CHECK(List_first(pList) == values + 1);
+    CHECK(List_add(pList, values + 9) == 0);
+    CHECK(List_remove_if(pList, s_is_even, NULL, NULL) == 4);
+    List_sort(pList, s_order_desc);
+    int *after[5] = {values + 9, values + 7, values + 5, values + 3, values + 1};
+    s_check_items(pList, after, 5);
+    s_check_items(pSnapshot, before, 8);
+    int key = 4;
+    List_first(pSnapshot);
+    CHECK(List_search(pSnapshot, s_is_below, &key) == values + 0);
+    CHECK(List_ref_item(pSnapshot, List_next_ref(pSnapshot, List_first_ref(pSnapshot))) == values + 1);
+    //a clone of a snapshot is a list that can be changed
+    List *pClone = List_clone(pSnapshot);
+    s_check_items(pClone, before, 8);
+    CHECK(List_remove(pClone) == NULL);
+    List_free(pClone, s_free_do_nothing);
+    //the old versions of the nodes changed take nodes of their own
+    CHECK(List_free_node_count() < LIST_MAX_NUM_NODES - 5);
+
+    //a second snapshot sees the changed list, the first one still the old one
+    List *pSecond = List_snapshot(pList);
+    CHECK(List_trim(pList) == values + 1);
+    CHECK(List_prepend(pList, values + 0) == 0);
+    s_check_items(pSecond, after, 5);
+    s_check_items(pSnapshot, before, 8);
+
+    //the last release gives every old version back
+    List_snapshot_release(pSnapshot);
+    s_check_items(pSecond, after, 5);
+    List_snapshot_release(pSecond);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES - 5);
+
+    //snapshots of inline lists copy the items with their nodes
+    List *pInline = List_create_inline(sizeof(int));
+    for(int i = 0; i < 4; ++i){
+        CHECK(List_append(pInline, values + i) == 0);
+    }
+    pSnapshot = List_snapshot(pInline);
+    List_free(pInline, s_free_do_nothing);
+    CHECK(List_count(pSnapshot) == 4);
+    int i = 0;
+    for(int *pItem = List_first(pSnapshot); pItem; pItem = List_next(pSnapshot)){
+        CHECK(*pItem == i++);
+    }
+    CHECK(i == 4);
+    List_snapshot_release(pSnapshot);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES - 5);
+
+    //with no node left for an old version the snapshot is emptied, not the change failed
+    pSnapshot = List_snapshot(pList);
+    List *pFill = List_create();
+    while(List_append(pFill, values) == 0){
+    }
+    CHECK(List_pop_front(pList) == values + 0);
+    CHECK(!List_snapshot_is_valid(pSnapshot));
+    CHECK(List_count(pSnapshot) == 0 && List_first(pSnapshot) == NULL);
+    CHECK(List_count(pList) == 4 && List_first(pList) == values + 9);
+    List_snapshot_release(pSnapshot);
+
+    List_free(pFill, s_free_do_nothing);
+    List_free(pList, s_free_do_nothing);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+
+//nodes laid out by List_load belong to the epoch the load starts, not the one they had
+static void s_test_snapshot_load(){
+    int values[6] = {0, 1, 2, 3, 4, 5};
+    List *pList = List_create_inline(sizeof(int));
+    for(int i = 0; i < 6; ++i){
+        CHECK(List_append(pList, values + i) == 0);
+    }
+    for(int i = 0; i < 3; ++i){
+        List *pSnapshot = List_snapshot(pList);
+        CHECK(List_pop_front(pList) != NULL);
+        CHECK(List_push_back(pList, values + i) == 0);
+        List_snapshot_release(pSnapshot);
+    }
+    List *pOld = List_snapshot(pList);
+    CHECK(List_pop_front(pList) != NULL);
+    CHECK(List_push_back(pList, values + 3) == 0);
+
+    FILE *pFile = tmpfile();
+    CHECK(pFile != NULL);
+    CHECK(List_save(pFile, &pList, 1, NULL) == 0);
+    List_snapshot_release(pOld);
+    List_free(pList, s_free_do_nothing);
+    rewind(pFile);
+    CHECK(List_load(pFile, &pList, 1, NULL) == 1);
+    fclose(pFile);
+
+    List *pSnapshot = List_snapshot(pList);
+    CHECK(List_pop_front(pList) != NULL);
+    int expected[6] = {4, 5, 0, 1, 2, 3};
+    int i = 0;
+    for(int *pItem = List_first(pSnapshot); pItem; pItem = List_next(pSnapshot)){
+        CHECK(*pItem == expected[i++]);
+    }
+    CHECK(i == 6);
+    List_snapshot_release(pSnapshot);
+    List_free(pList, s_free_do_nothing);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+#endif
+
+#ifdef LIST_ASYNC_FREE
+static pthread_t s_asyncCaller;
+static int s_asyncNumFreed = 0;
+static int s_asyncSum = 0;
+static bool s_asyncOnCaller = false;
+
+static void s_async_free(void *pItem){
+    s_asyncOnCaller |= pthread_equal(pthread_self(), s_asyncCaller);
+    __atomic_add_fetch(&s_asyncNumFreed, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s_asyncSum, *(int *)pItem, __ATOMIC_RELAXED);
+}
+
+//items that are lists of their own, freed from the reclaimer
+static void s_async_free_list(void *pItem){
+    List_free_async(pItem, s_async_free);
+}
+
+static void s_test_async_free(){
+    int values[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    s_asyncCaller = pthread_self();
+
+    //heads come back at once, items are freed on the reclaimer
+    for(int round = 0; round < 20; ++round){
+        List *pList = List_create();
+        CHECK(pList != NULL);
+        for(int i = 0; i < 8; ++i){
+            //nodes of lists freed before are back once the reclaimer is done with them
+            if(List_append(pList, values + i) != 0){
+                List_free_async_flush();
+                CHECK(List_append(pList, values + i) == 0);
+            }
+        }
+        List_free_async(pList, s_async_free);
+    }
+    List_free_async_flush();
+    CHECK(s_asyncNumFreed == 20 * 8 && s_asyncSum == 20 * 36);
+    CHECK(!s_asyncOnCaller);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+
+    //inline items and lists owned by items
+    List *pInline = List_create_inline(sizeof(int));
+    List *pOwner = List_create();
+    List *pOwned = List_create();
+    for(int i = 0; i < 8; ++i){
+        CHECK(List_append(pInline, values + i) == 0);
+        CHECK(List_append(pOwned, values + i) == 0);
+    }
+    CHECK(List_append(pOwner, pOwned) == 0);
+    List_free_async(pInline, s_async_free);
+    List_ts_free_async(pOwner, s_async_free_list);
+    List *pEmpty = List_create();
+    List_free_async(pEmpty, s_async_free);
+    List_free_async_flush();
+    CHECK(s_asyncNumFreed == 22 * 8 && s_asyncSum == 22 * 36);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+
+    //stopping empties the queue first, the next free starts the reclaimer again
+    List *pList = List_create();
+    CHECK(List_append(pList, values) == 0);
+    List_free_async(pList, s_async_free);
+    List_free_async_stop();
+    CHECK(s_asyncNumFreed == 22 * 8 + 1);
+    List_free_async_stop();
+    pList = List_create();
+    CHECK(List_append(pList, values) == 0);
+    List_free_async(pList, s_async_free);
+    List_free_async_stop();
+    CHECK(s_asyncNumFreed == 22 * 8 + 2 && !s_asyncOnCaller);
+    CHECK(List_free_node_count() == LIST_MAX_NUM_NODES);
+}
+#endif
+
 int main(int argCount, char *args[]) 
 {
     testComplex();
 
     s_test();
 
+    s_test_bulk();
+
+    s_test_clone();
+
+    s_test_sort();
+
+    s_test_insert_sorted();
+
+    s_test_intrusive();
+
+    s_test_timer_wheel();
+
+    s_test_inline();
+
+    s_test_deque();
+
+    s_test_remove_if();
+
+    s_test_save();
+
+    s_test_pool();
+
+    s_test_pool_map();
+
+#ifdef LIST_ALIGNED_HEADS
+    s_test_aligned_heads();
+#endif
+
+#if LIST_SMALL_SIZE
+    s_test_small_size();
+#endif
+
+#ifdef LIST_SNAPSHOT
+    s_test_snapshot();
+
+    s_test_snapshot_load();
+#endif
+
+#ifdef LIST_STATS
+    s_test_stats();
+#endif
+
+#ifdef LIST_TRACE
+    s_test_trace();
+#endif
+
+#ifdef LIST_RECORD
+    s_test_record();
+#endif
+
+#ifdef LIST_RCU
+    s_test_rcu();
+#endif
+
+#ifdef LIST_THREAD_SAFE
+    s_test_ts();
+#endif
+
+#ifdef LIST_ASYNC_FREE
+    s_test_async_free();
+#endif
+
 
     // We got here?!? PASSED!
     printf("********************************\n");
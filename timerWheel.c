@@ -0,0 +1,281 @@
+#include <assert.h>
+#include "timerWheel.h"
+
+#if TIMER_WHEEL_SLOTS < 2 || (TIMER_WHEEL_SLOTS & (TIMER_WHEEL_SLOTS - 1))
+#error "TIMER_WHEEL_SLOTS must be a power of two of at least 2"
+#endif
+#if TIMER_WHEEL_LEVELS < 2
+#error "TIMER_WHEEL_LEVELS must be at least 2"
+#endif
+
+//bits of a tick that pick the slot on each level
+#define SLOT_BITS __builtin_ctz(TIMER_WHEEL_SLOTS)
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+//centralized assert
+static void s_TimerWheel_assert(TimerWheel *pWheel)
+{
+    assert(pWheel != NULL);
+    assert(pWheel->pExpired != NULL);
+}
+
+//number of ticks a slot of level spans, level TIMER_WHEEL_LEVELS being the whole wheel
+static uint64_t s_span(int level)
+{
+    return (uint64_t)1 << (level * SLOT_BITS);
+}
+
+static void s_unschedule(void *pItem)
+{
+    Timer *pTimer = pItem;
+    pTimer->pSlot = NULL;
+    pTimer->ref = 0;
+}
+
+//give every slot taken so far back to the pool
+static void s_free_slots(TimerWheel *pWheel)
+{
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level)
+    {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; ++slot)
+        {
+            if (pWheel->slots[level][slot])
+            {
+                List_free(pWheel->slots[level][slot], s_unschedule);
+                pWheel->slots[level][slot] = NULL;
+            }
+        }
+    }
+    if (pWheel->pExpired)
+    {
+        List_free(pWheel->pExpired, s_unschedule);
+        pWheel->pExpired = NULL;
+    }
+}
+
+//slot a timer expiring at expiry goes in: the lowest level whose slots reach that far
+static List *s_slot(TimerWheel *pWheel, uint64_t expiry)
+{
+    uint64_t delta = expiry > pWheel->now ? expiry - pWheel->now : 0;
+    int level = 0;
+    while (level + 1 < TIMER_WHEEL_LEVELS && delta >= s_span(level + 1))
+    {
+        ++level;
+    }
+
+    //timers beyond the span of the wheel wait in the last slot it reaches,
+    //and are placed again when the wheel gets there
+    if (delta >= s_span(TIMER_WHEEL_LEVELS))
+    {
+        expiry = pWheel->now + s_span(TIMER_WHEEL_LEVELS) - 1;
+    }
+    return pWheel->slots[level][(expiry >> (level * SLOT_BITS)) & SLOT_MASK];
+}
+
+//put pTimer in the slot of its expiry, return 0 on success, -1 if there is no free node
+static int s_place(TimerWheel *pWheel, Timer *pTimer)
+{
+    List *pSlot = s_slot(pWheel, pTimer->expiry);
+    if (List_push_back(pSlot, pTimer) != 0)
+    {
+        return -1;
+    }
+    pTimer->pSlot = pSlot;
+    pTimer->ref = List_last_ref(pSlot);
+    return 0;
+}
+
+//hand count timers of pTimers over to the expire routine
+static void s_hand_over(TimerWheel *pWheel, Timer **pTimers, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        s_unschedule(pTimers[i]);
+    }
+    pWheel->count -= count;
+    pWheel->pExpireFn(pTimers, count, pWheel->pContext);
+}
+
+//move the timers of the slot of level that has come due to the levels below,
+//return the number of timers that expired early for lack of a node
+static int s_cascade(TimerWheel *pWheel, int level)
+{
+    List *pSlot = pWheel->slots[level][(pWheel->now >> (level * SLOT_BITS)) & SLOT_MASK];
+    int numExpired = 0;
+
+    //timers scheduled by the expire routine meanwhile go to the back and stay
+    for (int i = List_count(pSlot); i > 0; --i)
+    {
+        Timer *pTimer = List_pop_front(pSlot);
+
+        //the node just given back is there for the timer to take again, unless other
+        //threads or RCU readers hold it; a timer that cannot move is handed over now,
+        //its expiry telling the routine it is early, instead of being lost
+        if (s_place(pWheel, pTimer) != 0)
+        {
+            s_hand_over(pWheel, &pTimer, 1);
+            ++numExpired;
+        }
+    }
+    return numExpired;
+}
+
+//hand the timers of the current tick over, return how many there were
+static int s_expire(TimerWheel *pWheel)
+{
+    List **ppSlot = &pWheel->slots[0][pWheel->now & SLOT_MASK];
+    if (!List_count(*ppSlot))
+    {
+        return 0;
+    }
+
+    //the slot swaps places with the empty expired list, which takes all its timers
+    //at once and leaves the slot empty for timers the expire routine schedules
+    List *pExpired = *ppSlot;
+    *ppSlot = pWheel->pExpired;
+    pWheel->pExpired = pExpired;
+
+    Timer *batch[TIMER_WHEEL_BATCH_SIZE];
+    int numExpired = 0;
+    while (List_count(pExpired))
+    {
+        int count = 0;
+        while (count < TIMER_WHEEL_BATCH_SIZE && List_count(pExpired))
+        {
+            batch[count++] = List_pop_front(pExpired);
+        }
+        //timers still in pExpired can be cancelled or scheduled again by the routine
+        s_hand_over(pWheel, batch, count);
+        numExpired += count;
+    }
+    return numExpired;
+}
+
+// Makes pWheel an empty wheel at tick 0, that hands expired timers to pExpireFn along with
+// pContext. The TimerWheel itself is owned by the caller, its slots are taken from the pool.
+// Returns 0 on success, or -1 if there are fewer than TIMER_WHEEL_NUM_HEADS free heads.
+int TimerWheel_init(TimerWheel *pWheel, TIMER_FN pExpireFn, void *pContext)
+{
+    assert(pWheel != NULL);
+    assert(pExpireFn != NULL);
+    assert(TIMER_WHEEL_LEVELS * SLOT_BITS < 64);
+
+    pWheel->pExpired = List_create();
+    bool isCreated = pWheel->pExpired != NULL;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level)
+    {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; ++slot)
+        {
+            pWheel->slots[level][slot] = isCreated ? List_create() : NULL;
+            isCreated = pWheel->slots[level][slot] != NULL;
+        }
+    }
+    if (!isCreated)
+    {
+        s_free_slots(pWheel);
+        return -1;
+    }
+
+    pWheel->now = 0;
+    pWheel->count = 0;
+    pWheel->isAdvancing = false;
+    pWheel->pExpireFn = pExpireFn;
+    pWheel->pContext = pContext;
+    return 0;
+}
+
+// Unschedules every timer of pWheel, without handing them to the expire routine, and gives
+// its slots back to the pool.
+void TimerWheel_free(TimerWheel *pWheel)
+{
+    s_TimerWheel_assert(pWheel);
+    assert(!pWheel->isAdvancing);
+    s_free_slots(pWheel);
+    pWheel->count = 0;
+}
+
+// Returns the number of timers scheduled in pWheel.
+int TimerWheel_count(TimerWheel *pWheel)
+{
+    s_TimerWheel_assert(pWheel);
+    return pWheel->count;
+}
+
+// Schedules pTimer to expire delay ticks from now, or on the next tick for delay 0.
+// A timer that is already scheduled is moved to its new expiry.
+// Returns 0 on success, or -1 if there is no free node, leaving pTimer unscheduled.
+int TimerWheel_schedule(TimerWheel *pWheel, Timer *pTimer, uint64_t delay)
+{
+    s_TimerWheel_assert(pWheel);
+    assert(pTimer != NULL);
+    TimerWheel_cancel(pWheel, pTimer);
+
+    if (!delay)
+    {
+        delay = 1;
+    }
+    pTimer->expiry = delay > UINT64_MAX - pWheel->now ? UINT64_MAX : pWheel->now + delay;
+    if (s_place(pWheel, pTimer) != 0)
+    {
+        return -1;
+    }
+    ++pWheel->count;
+    return 0;
+}
+
+// Takes pTimer out of pWheel before it expires.
+// Returns true if it was scheduled, false if it was not.
+bool TimerWheel_cancel(TimerWheel *pWheel, Timer *pTimer)
+{
+    s_TimerWheel_assert(pWheel);
+    assert(pTimer != NULL);
+    if (!pTimer->pSlot)
+    {
+        return false;
+    }
+
+    //the ref leads straight to the node, without searching the slot
+    List_seek_ref(pTimer->pSlot, pTimer->ref);
+    assert(List_curr(pTimer->pSlot) == pTimer);
+    List_remove(pTimer->pSlot);
+    s_unschedule(pTimer);
+    --pWheel->count;
+    return true;
+}
+
+// Moves pWheel ticks ticks on, handing the timers of every tick to the expire routine in
+// batches of up to TIMER_WHEEL_BATCH_SIZE, in the order of their ticks. The routine may
+// schedule and cancel timers, but must not advance pWheel. A timer moving down a level gives
+// its node back and takes one again; should another thread or an RCU reader hold on to it,
+// the timer is handed over early, with its expiry still ahead of now, instead of being lost.
+// Returns the number of timers that expired.
+int TimerWheel_advance(TimerWheel *pWheel, uint64_t ticks)
+{
+    s_TimerWheel_assert(pWheel);
+    assert(!pWheel->isAdvancing);
+    pWheel->isAdvancing = true;
+
+    int numExpired = 0;
+    for (uint64_t tick = 0; tick < ticks; ++tick)
+    {
+        //an empty wheel has nothing to move down or hand over on the ticks left
+        if (!pWheel->count)
+        {
+            pWheel->now += ticks - tick;
+            break;
+        }
+        ++pWheel->now;
+
+        //each level that wraps around brings the next slot of the level above due
+        for (int level = 1;
+             level < TIMER_WHEEL_LEVELS && !(pWheel->now & (s_span(level) - 1));
+             ++level)
+        {
+            numExpired += s_cascade(pWheel, level);
+        }
+        numExpired += s_expire(pWheel);
+    }
+
+    pWheel->isAdvancing = false;
+    return numExpired;
+}
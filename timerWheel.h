@@ -0,0 +1,114 @@
+// Hierarchical timer wheel on lists from the List pool.
+// Every slot of the wheel is a List of the timers that expire in it. Level 0 has a slot
+// for each of the next TIMER_WHEEL_SLOTS ticks, and each level above has slots that span
+// TIMER_WHEEL_SLOTS slots of the level below, so scheduling and cancelling a timer take
+// the same time however many timers there are and however far off they expire. When the
+// wheel reaches a slot of a level above 0, its timers move down to the level below, each
+// at most once per level. Timers further off than the wheel spans wait in its last slot.
+//
+// The caller embeds a Timer in its own structs, as with IListLink, and finds them back
+// from the Timer pointers handed to its expire routine:
+//
+//     static void s_expire(Timer **ppTimers, int count, void *pContext)
+//     {
+//         for (int i = 0; i < count; ++i)
+//         {
+//             Request *pRequest = TIMER_ENTRY(ppTimers[i], Request, timer);
+//         }
+//     }
+//
+// A wheel is not thread safe; it is meant to be driven by one thread.
+
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "list.h"
+
+// Number of levels, at least 2, and slots on each level, a power of two of at least 2.
+// A wheel spans TIMER_WHEEL_SLOTS to the power of TIMER_WHEEL_LEVELS ticks, 2^24 by default,
+// and a timer moves down at most once per level on its way there. It takes
+// TIMER_WHEEL_NUM_HEADS heads from the pool, 257 by default, so LIST_MAX_NUM_HEADS has to
+// be raised to fit it; with fewer levels or slots a wheel takes fewer heads, but timers
+// further off than it spans wait in its last slot and are placed again on every turn.
+// (You may modify their values for your needs, or define them when compiling)
+#ifndef TIMER_WHEEL_LEVELS
+#define TIMER_WHEEL_LEVELS 4
+#endif
+#ifndef TIMER_WHEEL_SLOTS
+#define TIMER_WHEEL_SLOTS 64
+#endif
+#define TIMER_WHEEL_NUM_HEADS (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS + 1)
+
+// Most timers handed to the expire routine in one call
+#ifndef TIMER_WHEEL_BATCH_SIZE
+#define TIMER_WHEEL_BATCH_SIZE 32
+#endif
+
+// A timer, which must be zeroed before it is first scheduled.
+typedef struct Timer_s Timer;
+struct Timer_s {
+    //tick the timer expires at
+    uint64_t expiry;
+
+    //slot list and node the timer is in, NULL and 0 while it is not scheduled
+    List* pSlot;
+    NodeRef ref;
+};
+
+// Returns a pointer to the struct of type that embeds pTimer as member.
+#define TIMER_ENTRY(pTimer, type, member) \
+    ((type*)((char*)(pTimer) - offsetof(type, member)))
+
+// Routine that gets the timers that expired, count of them at a time, which are no longer
+// scheduled and may be scheduled again or freed. A timer whose expiry is after the now of
+// the wheel is handed over early, see TimerWheel_advance; schedule it again for the ticks
+// it has left to keep it.
+typedef void (*TIMER_FN)(Timer** ppTimers, int count, void* pContext);
+
+typedef struct TimerWheel_s TimerWheel;
+struct TimerWheel_s {
+    List* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    //slot of the current tick, taken out of the wheel while its timers are handed over
+    List* pExpired;
+
+    //ticks advanced since TimerWheel_init
+    uint64_t now;
+    int count;
+    bool isAdvancing;
+
+    TIMER_FN pExpireFn;
+    void* pContext;
+};
+
+// Makes pWheel an empty wheel at tick 0, that hands expired timers to pExpireFn along with
+// pContext. The TimerWheel itself is owned by the caller, its slots are taken from the pool.
+// Returns 0 on success, or -1 if there are fewer than TIMER_WHEEL_NUM_HEADS free heads.
+int TimerWheel_init(TimerWheel* pWheel, TIMER_FN pExpireFn, void* pContext);
+
+// Unschedules every timer of pWheel, without handing them to the expire routine, and gives
+// its slots back to the pool.
+void TimerWheel_free(TimerWheel* pWheel);
+
+// Returns the number of timers scheduled in pWheel.
+int TimerWheel_count(TimerWheel* pWheel);
+
+// Schedules pTimer to expire delay ticks from now, or on the next tick for delay 0.
+// A timer that is already scheduled is moved to its new expiry.
+// Returns 0 on success, or -1 if there is no free node, leaving pTimer unscheduled.
+int TimerWheel_schedule(TimerWheel* pWheel, Timer* pTimer, uint64_t delay);
+
+// Takes pTimer out of pWheel before it expires.
+// Returns true if it was scheduled, false if it was not.
+bool TimerWheel_cancel(TimerWheel* pWheel, Timer* pTimer);
+
+// Moves pWheel ticks ticks on, handing the timers of every tick to the expire routine in
+// batches of up to TIMER_WHEEL_BATCH_SIZE, in the order of their ticks. The routine may
+// schedule and cancel timers, but must not advance pWheel. A timer moving down a level gives
+// its node back and takes one again; should another thread or an RCU reader hold on to it,
+// the timer is handed over early, with its expiry still ahead of now, instead of being lost.
+// Returns the number of timers that expired.
+int TimerWheel_advance(TimerWheel* pWheel, uint64_t ticks);
+
+#endif